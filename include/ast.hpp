@@ -0,0 +1,61 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#ifndef AST_HPP
+#define AST_HPP
+
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+struct Expr;
+struct Stmt;
+
+// the syntax tree of one module: a script, an imported file or a line of the prompt
+// nodes are cut from large chunks the tree owns and point at each other with plain pointers,
+// the whole tree goes away with the module instead of node by node
+class Ast
+{
+    private:
+        // a node that owns memory outside the chunks (a list of children, a string)
+        struct Destructor
+        {
+            void* node;
+            void (*destroy)(void* node);
+        };
+
+        std::vector<std::unique_ptr<char[]>> chunks;
+        char* chunk = nullptr; // unused rest of the newest chunk
+        char* chunk_end = nullptr;
+        std::vector<Destructor> destructors;
+
+        void* allocate(size_t size, size_t align);
+
+    public:
+        std::vector<Stmt*> statements;
+        Expr* expression = nullptr; // a prompt line made of a single expression, its value gets printed
+
+        Ast() = default;
+        Ast(const Ast&) = delete;
+        Ast& operator=(const Ast&) = delete;
+        ~Ast();
+
+        template <class T, class... Args>
+        T* make(Args&&... args)
+        {
+            T* node = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+            if constexpr (!std::is_trivially_destructible_v<T>)
+                destructors.push_back(Destructor{node, [](void* node) { static_cast<T*>(node)->~T(); }});
+
+            return node;
+        }
+};
+
+#endif
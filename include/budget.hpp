@@ -0,0 +1,52 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#ifndef BUDGET_HPP
+#define BUDGET_HPP
+
+#pragma once
+#include <cstdint>
+#include <functional>
+
+#include "heap.hpp"
+
+// counts the steps a program takes, a step is one loop iteration or one call
+// straight-line code between two steps is bounded by the size of the program,
+// so a step budget limits the work of a program the same way on every run and every host
+class Budget
+{
+    private:
+        Heap& heap; // collected at the same safe points
+        uint64_t steps = 0;
+        uint64_t limit = 0; // set by --max-steps, 0 for no limit
+        uint64_t next_check = UINT64_MAX; // step of the next budget check or callback
+
+        uint64_t interval = 0; // steps between two calls of the callback, 0 for none
+        std::function<bool(uint64_t)> callback;
+
+        void check();
+        void schedule();
+
+    public:
+        Budget(Heap& heap) : heap(heap) {}
+
+        void set_limit(uint64_t max_steps);
+
+        // an embedding host is called every interval steps with the steps taken so far
+        // it can check a deadline or let other work run, returning false cancels the program
+        void set_callback(uint64_t interval, std::function<bool(uint64_t)> callback);
+        uint64_t taken() const { return steps; }
+
+        // every engine ticks at its loop back edges and calls, which are also the heap's safe points
+        void tick()
+        {
+            if (++steps >= next_check)
+                check();
+
+            heap.poll();
+        }
+};
+
+#endif
@@ -13,58 +13,64 @@
 #include <ctime>
 #include <cstring>
 #include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "list.hpp"
 #include "callable.hpp"
+#include "error.hpp"
 
-class NativeClock : public NblCallable
+class NativeClock : public NblNative
 {
     public:
         int arity() override;
-        std::any call(Interpreter& interpreter, std::vector<std::any> args) override;
+        Value call(const Token& paren, std::vector<Value> args) override;
         std::string to_string() override;
 };
 
-class NativeTime : public NblCallable
+class NativeTime : public NblNative
 {
     public:
         int arity() override;
-        std::any call(Interpreter& interpreter, std::vector<std::any> args) override;
+        Value call(const Token& paren, std::vector<Value> args) override;
         std::string to_string() override;
 };
 
-class NativeInput : public NblCallable
+class NativeInput : public NblNative
 {
     public:
         int arity() override;
-        std::any call(Interpreter& interpreter, std::vector<std::any> args) override;
+        Value call(const Token& paren, std::vector<Value> args) override;
         std::string to_string() override;
 };
 
-class NativeExit : public NblCallable
+class NativeExit : public NblNative
 {
     public:
-        int param_count;
-        
         int arity() override;
-        std::any call(Interpreter& interpreter, std::vector<std::any> args) override;
+        bool accepts(int argc) override;
+        Value call(const Token& paren, std::vector<Value> args) override;
         std::string to_string() override;
 };
 
-class NativeFloorDiv : public NblCallable
+class NativeFloorDiv : public NblNative
 {
     public:
         int arity() override;
-        std::any call(Interpreter& interpreter, std::vector<std::any> args) override;
+        Value call(const Token& paren, std::vector<Value> args) override;
         std::string to_string() override;
 };
 
-class NativeArrayLen : public NblCallable
+class NativeArrayLen : public NblNative
 {
     public:
         int arity() override;
-        std::any call(Interpreter& interpreter, std::vector<std::any> args) override;
+        Value call(const Token& paren, std::vector<Value> args) override;
         std::string to_string() override;
 };
 
+// every builtin under its global name, engines define their globals from this table
+std::vector<std::pair<std::string, NblNative*>> make_natives();
+
 #endif
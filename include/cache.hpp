@@ -0,0 +1,62 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "value.hpp"
+#include "shape.hpp"
+
+class NblInstance;
+class NblCallable;
+
+struct CacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
+
+// what a property name resolved to on instances of one shape
+// shapes belong to a single class and methods never change, so the entry stays valid
+struct CacheEntry
+{
+    Ref<Shape> shape;
+    int offset = -1; // field offset, -1 when the name isn't a field
+    NblCallable* method = nullptr; // method found instead, nullptr if undefined
+    Shape* next = nullptr; // shape after a set adds the field, kept alive by shape
+};
+
+// inline cache of a property access site, remembers up to WAYS shapes
+class InlineCache
+{
+    private:
+        static const int WAYS = 4;
+
+        CacheStats* stats;
+        CacheEntry entries[WAYS];
+        int count = 0;
+        int evict = 0; // next entry replaced once every way is taken
+
+        CacheEntry* find(Shape* shape);
+        CacheEntry& replace(Shape* shape);
+
+    public:
+        // counters of every site, printed by --cache-stats
+        static CacheStats get_stats;
+        static CacheStats set_stats;
+        static CacheStats call_stats;
+
+        InlineCache(CacheStats& stats);
+        // the name is only looked at on a miss
+        const CacheEntry& get(NblInstance* instance, std::string_view name);
+        void set(NblInstance* instance, std::string_view name, Value value);
+        static void print_stats();
+};
+
+#endif
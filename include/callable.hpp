@@ -8,18 +8,37 @@
 
 #pragma once
 #include <vector>
-#include <any>
 #include <string>
 
-class Interpreter;
+#include "value.hpp"
+#include "token.hpp"
 
-class NblCallable
+// function types for resolution, methods and initializers take 'this' as their first slot
+enum class FunctionType
+{
+    NONE,
+    FUNCTION,
+    INITIALIZER,
+    METHOD
+};
+
+// anything a script can call, each engine calls its own function types directly
+class NblCallable : public Object
 {
     public:
-        virtual ~NblCallable() = default;
         virtual int arity() = 0;
-        virtual std::any call(Interpreter& interpreter, std::vector<std::any> arguments) = 0;
         virtual std::string to_string() = 0;
 };
 
+// builtin functions, they don't need an engine to run
+// paren is the call site, for the errors of arguments of the wrong type
+class NblNative : public NblCallable
+{
+    public:
+        virtual Value call(const Token& paren, std::vector<Value> arguments) = 0;
+
+        // natives with optional arguments take fewer than their arity
+        virtual bool accepts(int argc) { return argc == arity(); }
+};
+
 #endif
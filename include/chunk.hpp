@@ -0,0 +1,107 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#ifndef CHUNK_HPP
+#define CHUNK_HPP
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "value.hpp"
+#include "cache.hpp"
+
+// instructions of the vm, operands follow the opcode byte
+// u8 is a one byte operand, u16 a two byte big endian operand, u24 a three byte one
+// index operands (slots, constants, caches, globals) past their short form take a LONG prefix
+enum class OpCode : uint8_t
+{
+    LONG, // the index operands of the next instruction are u24
+    CONSTANT, // u16 constant
+    NIL,
+    TRUE,
+    FALSE,
+    POP,
+
+    GET_LOCAL, // u8 slot
+    SET_LOCAL, // u8 slot
+    GET_UPVALUE, // u8 upvalue
+    SET_UPVALUE, // u8 upvalue
+    GET_GLOBAL, // u16 global
+    DEFINE_GLOBAL, // u16 global
+    SET_GLOBAL, // u16 global
+    GET_PROPERTY, // u16 name constant, u16 inline cache
+    SET_PROPERTY, // u16 name constant, u16 inline cache
+    GET_SUPER, // u16 name constant
+    LOAD_METHOD, // u16 name constant, u16 inline cache, pushes the method under its receiver
+
+    EQUAL,
+    NOT_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+    LESS,
+    LESS_EQUAL,
+    ADD,
+    SUBTRACT,
+    MULTIPLY,
+    DIVIDE,
+    MODULO,
+    POWER,
+    NOT,
+    NEGATE,
+
+    PRINT,
+    JUMP, // u24 forward offset
+    JUMP_IF_FALSE, // u24 forward offset, keeps the condition
+    JUMP_IF_TRUE, // u24 forward offset, keeps the condition
+    POP_JUMP_IF_FALSE, // u24 forward offset, pops the condition
+    LOOP, // u24 backward offset
+
+    CALL, // u8 argument count
+    CALL_METHOD, // u8 argument count, calls what LOAD_METHOD found
+    TAIL_CALL, // u8 argument count, a closure callee takes over the frame, RETURN follows
+    TAIL_CALL_METHOD, // u8 argument count
+    CLOSURE, // u16 prototype, then a (u8 is_local, u8 index) pair per upvalue
+    CLOSE_UPVALUE,
+    RETURN,
+    CLASS, // u16 name constant, then u8 has superclass even after LONG
+    METHOD, // u16 name constant
+    LIST, // u8 element count
+    GET_INDEX,
+    SET_INDEX,
+    CHECK_INSTANCE, // the receiver of a SET_PROPERTY, checked before the value runs
+    CHECK_SUBSCRIPT, // the list and index of a SET_INDEX, checked before the value runs
+    IMPORT // u16 path constant
+};
+
+class NblPrototype;
+
+// a compiled function body
+struct Chunk
+{
+    std::vector<uint8_t> code;
+    std::vector<int> lines; // source line of every byte in code
+    std::vector<Value> constants;
+    std::vector<Ref<NblPrototype>> prototypes; // functions declared in this one
+    std::vector<InlineCache> caches; // one per property access site
+
+    void write(uint8_t byte, int line);
+    int add_constant(Value value);
+    int add_cache(CacheStats& stats);
+};
+
+// everything a closure needs that doesn't change between instances
+class NblPrototype : public Object
+{
+    public:
+        std::string name;
+        int arity = 0;
+        int upvalue_count = 0;
+        int max_stack = 0; // deepest the function's stack gets, slot 0 included
+        Chunk chunk;
+};
+
+#endif
@@ -7,7 +7,6 @@
 #define CLASS_HPP
 
 #pragma once
-#include <any>
 #include <memory>
 #include <string>
 #include <vector>
@@ -17,25 +16,38 @@
 #include "callable.hpp"
 #include "instance.hpp"
 #include "function.hpp"
+#include "shape.hpp"
+#include "symbol.hpp"
 
 class Interpreter;
 class NblFunction;
 
-class NblClass : public NblCallable, public std::enable_shared_from_this<NblClass>
+// methods hold the function type of the engine that declared the class
+// inherited methods are copied in when the class is made, a lookup never walks the chain
+class NblClass : public NblCallable
 {
     friend class NblInstance;
     
     private:
         std::string name;
-        std::shared_ptr<NblClass> superclass;
-        std::map<std::string, std::shared_ptr<NblFunction>> methods;
+        Ref<NblClass> superclass;
+        std::vector<std::pair<Symbol, Ref<NblCallable>>> methods; // sorted by the symbol of the method name
+        NblCallable* init = nullptr;
+        int init_arity = 0;
+        Ref<Shape> root_shape{new Shape}; // shape of a new instance, before init adds fields
+        int field_count = 0; // most fields an instance has had, reserved up front for new ones
 
     public:
-        NblClass(std::string name, std::shared_ptr<NblClass> superclass, std::map<std::string, std::shared_ptr<NblFunction>> methods);
-        std::shared_ptr<NblFunction> find_method(const std::string& name);
+        NblClass(std::string name, Ref<NblClass> superclass, std::map<std::string, Ref<NblCallable>> methods);
+        void add_method(const std::string& name, Ref<NblCallable> method);
+        NblCallable* find_method(const std::string& name);
+        NblCallable* find_method(Symbol symbol);
+        NblCallable* initializer() { return init; }
         int arity() override;
-        std::any call(Interpreter& interpreter, std::vector<std::any> arguments) override;
+        Value call(Interpreter& interpreter, std::vector<Value> arguments);
         std::string to_string() override;
+        void trace(Tracer& tracer) override;
+        void clear() override;
 };
 
 #endif
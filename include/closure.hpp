@@ -0,0 +1,56 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#ifndef CLOSURE_HPP
+#define CLOSURE_HPP
+
+#pragma once
+#include <string>
+#include <vector>
+
+#include "value.hpp"
+#include "callable.hpp"
+#include "chunk.hpp"
+
+// a captured variable, points into a stack slot until its scope ends
+class NblUpvalue : public Object
+{
+    public:
+        Value* location;
+        Value closed;
+        NblUpvalue* next = nullptr; // next open upvalue, lower on the stack
+
+        NblUpvalue(Value* location);
+        void trace(Tracer& tracer) override;
+        void clear() override;
+};
+
+class NblClosure : public NblCallable
+{
+    public:
+        Ref<NblPrototype> prototype;
+        std::vector<Ref<NblUpvalue>> upvalues;
+
+        NblClosure(Ref<NblPrototype> prototype);
+        int arity() override;
+        std::string to_string() override;
+        void trace(Tracer& tracer) override;
+        void clear() override;
+};
+
+class NblBoundMethod : public NblCallable
+{
+    public:
+        Value receiver;
+        Ref<NblClosure> method;
+
+        NblBoundMethod(Value receiver, Ref<NblClosure> method);
+        int arity() override;
+        std::string to_string() override;
+        void trace(Tracer& tracer) override;
+        void clear() override;
+};
+
+#endif
@@ -0,0 +1,122 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#ifndef CLOSURE_COMPILER_HPP
+#define CLOSURE_COMPILER_HPP
+
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "expr.hpp"
+#include "stmt.hpp"
+#include "error.hpp"
+#include "value.hpp"
+#include "callable.hpp"
+#include "environment.hpp"
+#include "instance.hpp"
+#include "closure.hpp"
+
+class ClosureEngine;
+
+using EnvironmentPtr = Ref<Environment>;
+
+// a node compiled into a C++ closure, it runs against the environment of its scope
+using ExprCode = std::function<Value(const EnvironmentPtr&)>;
+using StmtCode = std::function<Completion(const EnvironmentPtr&)>;
+
+// the compiled body of a function declaration, shared by every function made from it
+struct FunctionCode
+{
+    int arity;
+    int slot_count; // parameters plus locals, one environment slot each
+    bool is_method; // slot 0 holds 'this', the parameters follow
+    std::vector<Capture> captures; // free variables, depth counted in environments instead of scopes
+    std::vector<StmtCode> body;
+};
+
+class NblCompiledFunction : public NblCallable
+{
+    public:
+        std::string name;
+        std::shared_ptr<FunctionCode> code;
+        std::vector<Ref<NblUpvalue>> upvalues; // the free variables, in the order of code->captures
+        bool is_initializer;
+        Value receiver; // 'this' of a method used as a value, set by bind
+
+        NblCompiledFunction(std::string name, std::shared_ptr<FunctionCode> code, std::vector<Ref<NblUpvalue>> upvalues, bool is_initializer);
+        Ref<NblCompiledFunction> bind(Ref<NblInstance> instance);
+        int arity() override;
+        std::string to_string() override;
+        void trace(Tracer& tracer) override;
+        void clear() override;
+};
+
+// turns a resolved program into closures for the closure engine
+// operators, slots and constant operands are picked once here instead of on every evaluation
+class ClosureCompiler : public ExprVisitor, public StmtVisitor
+{
+    private:
+        // a scope opened by the resolver, blocks without locals don't get an environment at runtime
+        struct Scope
+        {
+            int count; // slots handed out so far
+            bool materialized;
+        };
+
+        ClosureEngine& engine;
+        std::vector<Scope> scopes;
+        ExprCode expr_code; // result of the last expression visited
+        StmtCode stmt_code; // result of the last statement visited
+
+        ExprCode compile(Expr* expr);
+        StmtCode compile(Stmt* stmt);
+        std::vector<StmtCode> compile_block(const std::vector<Stmt*>& statements);
+        std::shared_ptr<FunctionCode> compile_function(FunctionExpr* fn, bool is_method);
+        ExprCode property(GetExpr* expr, CacheStats& stats);
+        ExprCode invoke(CallExpr* expr);
+        int hops(int depth);
+        int declare();
+        ExprCode load(const LocalSlot& local, const Token& name);
+        ExprCode store(const LocalSlot& local, const Token& name, ExprCode value);
+        StmtCode define(const Token& name, int slot, ExprCode value);
+
+    public:
+        ClosureCompiler(ClosureEngine& engine);
+        std::vector<StmtCode> compile(const std::vector<Stmt*>& statements);
+        ExprCode compile_expression(Expr* expr);
+
+        Value visitAssignExpr(AssignExpr* expr) override;
+        Value visitBinaryExpr(BinaryExpr* expr) override;
+        Value visitGroupingExpr(GroupingExpr* expr) override;
+        Value visitLiteralExpr(LiteralExpr* expr) override;
+        Value visitUnaryExpr(UnaryExpr* expr) override;
+        Value visitMutExpr(MutExpr* expr) override;
+        Value visitLogicalExpr(LogicalExpr* expr) override;
+        Value visitCallExpr(CallExpr* expr) override;
+        Value visitFunctionExpr(FunctionExpr* expr) override;
+        Value visitGetExpr(GetExpr* expr) override;
+        Value visitSetExpr(SetExpr* expr) override;
+        Value visitThisExpr(ThisExpr* expr) override;
+        Value visitSuperExpr(SuperExpr* expr) override;
+        Value visitListExpr(ListExpr* expr) override;
+        Value visitSubscriptExpr(SubscriptExpr* expr) override;
+
+        Completion visitBlockStmt(BlockStmt* stmt) override;
+        Completion visitExpressionStmt(ExpressionStmt* stmt) override;
+        Completion visitPrintStmt(PrintStmt* stmt) override;
+        Completion visitMutStmt(MutStmt* stmt) override;
+        Completion visitIfStmt(IfStmt* stmt) override;
+        Completion visitWhileStmt(WhileStmt* stmt) override;
+        Completion visitFunctionStmt(FunctionStmt* stmt) override;
+        Completion visitReturnStmt(ReturnStmt* stmt) override;
+        Completion visitBreakStmt(BreakStmt* stmt) override;
+        Completion visitClassStmt(ClassStmt* stmt) override;
+        Completion visitImportStmt(ImportStmt* stmt) override;
+};
+
+#endif
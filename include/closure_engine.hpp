@@ -0,0 +1,62 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#ifndef CLOSURE_ENGINE_HPP
+#define CLOSURE_ENGINE_HPP
+
+#pragma once
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "engine.hpp"
+#include "error.hpp"
+#include "value.hpp"
+#include "environment.hpp"
+#include "closure_compiler.hpp"
+#include "builtins.hpp"
+#include "class.hpp"
+#include "instance.hpp"
+
+// runs programs compiled into closures, selected with --engine=closure
+class ClosureEngine : public Engine
+{
+    friend class ClosureCompiler;
+
+    private:
+        // globals are late bound by name, the compiler hands out the cell of each name once
+        struct Global
+        {
+            Value value;
+            bool defined = false;
+        };
+
+        std::unordered_map<std::string, Global> globals; // nodes are never moved, cells stay valid
+        Value return_value; // value carried by a RETURN completion
+        Value tail_function; // callee of a pending tail call, run by the caller's call_function
+        Value tail_receiver;
+        std::vector<Value> tail_arguments;
+        FrameStack frames; // slots of the running calls and blocks
+        std::vector<Ref<NblUpvalue>>* upvalues = nullptr; // captures of the running function
+
+        Global* global(const std::string& name);
+        void define_native(const std::string& name, NblNative* native);
+
+    public:
+        ClosureEngine(Heap& heap);
+        ~ClosureEngine();
+        void interpret(std::unique_ptr<Ast> module) override;
+        std::string interpret_expression(std::unique_ptr<Ast> module) override;
+        Value call_value(const Value& callee, std::vector<Value> arguments, const Token& paren);
+        Value invoke(NblCompiledFunction* function, const Value& receiver, std::vector<Value> arguments);
+        Value call_function(NblCompiledFunction* function, Frame& frame);
+        Value tail_call(NblCompiledFunction* function, const Value& receiver, std::vector<Value> arguments);
+        Value take_return_value();
+        Ref<NblCompiledFunction> make_function(std::string name, std::shared_ptr<FunctionCode> code, const EnvironmentPtr& env, bool is_initializer);
+};
+
+#endif
@@ -0,0 +1,137 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#ifndef COMPILER_HPP
+#define COMPILER_HPP
+
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "expr.hpp"
+#include "stmt.hpp"
+#include "error.hpp"
+#include "chunk.hpp"
+#include "resolver.hpp"
+
+class VM;
+
+// turns a resolved program into bytecode for the vm
+// the compiler opens the same scopes the resolver did, so a LocalSlot maps straight to a stack slot
+class Compiler : public ExprVisitor, public StmtVisitor
+{
+    private:
+        // a scope opened by the resolver, base is the stack slot of its first local
+        struct Scope
+        {
+            int function; // index of the function that owns the locals
+            int base;
+            int count = 0;
+        };
+
+        struct Upvalue
+        {
+            int index; // slot in the enclosing function, or its upvalue
+            bool is_local;
+        };
+
+        // where a 'break' jumps to: the end of a loop, a function body or a top level statement
+        struct BreakTarget
+        {
+            int scope_depth; // scopes at or above this are popped by the jump
+            std::vector<int> jumps;
+        };
+
+        struct FunctionState
+        {
+            Ref<NblPrototype> prototype;
+            FunctionType type;
+            std::vector<Upvalue> upvalues;
+            std::vector<bool> captured; // stack slots captured by a closure
+            std::vector<BreakTarget> breaks;
+            std::map<std::string, int> names; // constants already made for names
+            int local_count = 1; // slot 0 holds the callee, or the receiver for methods
+            int stack_depth = 1;
+        };
+
+        VM& vm;
+        std::vector<FunctionState> functions;
+        std::vector<Scope> scopes;
+        int line = 0;
+
+        FunctionState& current();
+        Chunk& chunk();
+        void compile(Stmt* stmt);
+        void compile(Expr* expr);
+        void compile_function(FunctionExpr* fn, FunctionType type, const std::string& name);
+        void begin_function(const std::string& name, FunctionType type);
+        FunctionState end_function();
+
+        void begin_scope();
+        void end_scope();
+        void discard_locals(const Scope& scope);
+        int declare_local(const Token& name);
+        void begin_break_target();
+        void end_break_target();
+
+        void emit_byte(uint8_t byte);
+        void emit_short(int value);
+        void emit_long(int value);
+        void emit_op(OpCode op);
+        void emit_indexed(OpCode op, int width, int index, int second = -1);
+        void emit_return();
+        int emit_jump(OpCode op);
+        void patch_jump(int offset);
+        void emit_loop(int start);
+        void emit_get(GetExpr* expr, CacheStats& stats);
+        void adjust_stack(int effect);
+
+        int make_constant(Value value);
+        int make_cache(CacheStats& stats);
+        int name_constant(const std::string& name);
+        int global(const std::string& name);
+        int resolve_upvalue(int function, int owner, int index);
+        int add_upvalue(FunctionState& function, int index, bool is_local);
+        void emit_load(const LocalSlot& local, const Token& name);
+        void emit_store(const LocalSlot& local, const Token& name);
+
+    public:
+        Compiler(VM& vm);
+        Ref<NblPrototype> compile(const std::vector<Stmt*>& statements);
+        Ref<NblPrototype> compile_expression(Expr* expr);
+
+        Value visitAssignExpr(AssignExpr* expr) override;
+        Value visitBinaryExpr(BinaryExpr* expr) override;
+        Value visitGroupingExpr(GroupingExpr* expr) override;
+        Value visitLiteralExpr(LiteralExpr* expr) override;
+        Value visitUnaryExpr(UnaryExpr* expr) override;
+        Value visitMutExpr(MutExpr* expr) override;
+        Value visitLogicalExpr(LogicalExpr* expr) override;
+        Value visitCallExpr(CallExpr* expr) override;
+        Value visitFunctionExpr(FunctionExpr* expr) override;
+        Value visitGetExpr(GetExpr* expr) override;
+        Value visitSetExpr(SetExpr* expr) override;
+        Value visitThisExpr(ThisExpr* expr) override;
+        Value visitSuperExpr(SuperExpr* expr) override;
+        Value visitListExpr(ListExpr* expr) override;
+        Value visitSubscriptExpr(SubscriptExpr* expr) override;
+
+        Completion visitBlockStmt(BlockStmt* stmt) override;
+        Completion visitExpressionStmt(ExpressionStmt* stmt) override;
+        Completion visitPrintStmt(PrintStmt* stmt) override;
+        Completion visitMutStmt(MutStmt* stmt) override;
+        Completion visitIfStmt(IfStmt* stmt) override;
+        Completion visitWhileStmt(WhileStmt* stmt) override;
+        Completion visitFunctionStmt(FunctionStmt* stmt) override;
+        Completion visitReturnStmt(ReturnStmt* stmt) override;
+        Completion visitBreakStmt(BreakStmt* stmt) override;
+        Completion visitClassStmt(ClassStmt* stmt) override;
+        Completion visitImportStmt(ImportStmt* stmt) override;
+};
+
+#endif
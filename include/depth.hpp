@@ -0,0 +1,53 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#ifndef DEPTH_HPP
+#define DEPTH_HPP
+
+#pragma once
+#include <cstddef>
+#include <functional>
+
+#include "error.hpp"
+#include "token.hpp"
+
+// calls in progress, bounded by --max-call-depth
+// the tree-walker and the closure engine recurse on the native stack for every call, so programs run
+// on a stack allocated on the heap for the limit, and a call past it fails with a RuntimeError
+// the vm keeps its frames on the heap and grows them up to the same limit
+class CallDepth
+{
+    private:
+        static size_t depth;
+        static size_t max_depth;
+        static const char* floor; // lowest address the native stack can reach, checked on every call
+
+        static void start();
+        static void run_on(size_t stack_size, const std::function<void()>& body);
+        [[noreturn]] static void overflow(const Token& token);
+
+    public:
+        static const size_t DEFAULT_LIMIT = 100000;
+        static const size_t FRAME_BYTES = 4096; // native stack of one call, a debug build takes about half
+
+        static void set_limit(size_t depth);
+        static size_t limit() { return max_depth; }
+
+        // runs the program on a native stack big enough for the limit
+        static void run(const std::function<void()>& body);
+
+        // one per call in progress
+        explicit CallDepth(const Token& token)
+        {
+            if (++depth > max_depth || static_cast<const char*>(__builtin_frame_address(0)) < floor)
+                overflow(token);
+        }
+
+        ~CallDepth() { depth--; }
+        CallDepth(const CallDepth&) = delete;
+        CallDepth& operator=(const CallDepth&) = delete;
+};
+
+#endif
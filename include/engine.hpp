@@ -0,0 +1,45 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#ifndef ENGINE_HPP
+#define ENGINE_HPP
+
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ast.hpp"
+#include "heap.hpp"
+#include "budget.hpp"
+#include "expr.hpp"
+#include "stmt.hpp"
+
+// an execution backend for resolved programs, picked with --engine
+// the host owns the heap, so what it reports outlives the engine
+class Engine
+{
+    private:
+        Heap* outer = nullptr; // current heap of whoever builds or frees the engine
+
+    protected:
+        // a derived engine's constructor ends with leave_heap(), its destructor starts with enter_heap()
+        // so its globals are built and its members freed in its own heap, and the host's comes back after
+        void enter_heap() { outer = Heap::make_current(&heap); }
+        void leave_heap() { Heap::make_current(outer); }
+
+    public:
+        Heap& heap; // objects of the programs this engine runs
+        Budget budget; // steps they take, and the host's callback
+
+        Engine(Heap& heap) : heap(heap), budget(heap) { enter_heap(); }
+        virtual ~Engine() { leave_heap(); }
+        // the engine takes the module, and frees it once nothing it runs points into the tree
+        virtual void interpret(std::unique_ptr<Ast> module) = 0;
+        // a prompt line that is a single expression, returns its value printed
+        virtual std::string interpret_expression(std::unique_ptr<Ast> module) = 0;
+};
+
+#endif
@@ -8,32 +8,85 @@
 
 #pragma once
 #include <memory>
-#include <any>
 #include <string>
 #include <map>
+#include <vector>
 #include <functional>
+#include <optional>
 #include <utility>
 
 #include "error.hpp"
 #include "token.hpp"
+#include "value.hpp"
+#include "heap.hpp"
 
-class Environment : public std::enable_shared_from_this<Environment>
+class NblUpvalue;
+
+class Environment : public Object
 {
     friend class Interpreter;
+    friend class ClosureCompiler;
+    friend class ClosureEngine;
+    friend class Frame;
 
-    std::shared_ptr<Environment> enclosing;
-    std::map<std::string, std::any> values;
+    Ref<Environment> enclosing;
+    std::map<std::string, Value, std::less<>> values; // globals, looked up by name
+    HeapVector<Value> storage; // slots of an environment that owns them
+    Value* slots; // locals, indexed by the slot the resolver gave them
+    int defined = 0; // number of slots defined so far
+    std::vector<Ref<NblUpvalue>> upvalues; // open upvalues pointing into the slots
 
     public:
         Environment();
-        Environment(std::shared_ptr<Environment> enclosing);
-
-        std::any get(const Token& name);
-        void assign(const Token& name, std::any value);
-        void define(const std::string& name, std::any value);
-        std::shared_ptr<Environment> ancestor(int distance);
-        std::any get_at(int distance, const std::string& name);
-        void assign_at(int distance, const Token& name, std::any value);
+        Environment(Ref<Environment> enclosing, int size);
+        Environment(Ref<Environment> enclosing, Value* slots);
+        Environment(const Environment&) = delete;
+        Environment& operator=(const Environment&) = delete;
+
+        Value get(const Token& name);
+        void assign(const Token& name, Value value);
+        void define(const std::string& name, Value value);
+        void define(Value value);
+        Environment* ancestor(int distance);
+        Value get_at(int distance, int slot);
+        void assign_at(int distance, int slot, Value value);
+        Ref<NblUpvalue> capture(int slot);
+        void close_upvalues();
+        void trace(Tracer& tracer) override;
+        void clear() override;
+};
+
+// slots for the environments of calls and blocks, handed out and given back in LIFO order
+// one per engine, it stands in for an allocation per call or block
+class FrameStack
+{
+    friend class Frame;
+
+    static const int STACK_MAX = 1 << 16; // a deeper program falls back to heap environments
+
+    std::unique_ptr<Value[]> values{new Value[STACK_MAX]};
+    Value* top = values.get();
+};
+
+// environment of a call or block, its slots come from the frame stack
+// frames end in the reverse order they start, captured variables are closed and the slots handed back at the end
+class Frame
+{
+    private:
+        FrameStack& stack;
+        Value* base = nullptr; // first slot on the frame stack, null for a heap environment
+        std::optional<Environment> local;
+        Ref<Environment> environment;
+
+        void enter(Ref<Environment> enclosing, int size);
+        void leave();
+
+    public:
+        Frame(FrameStack& stack, Ref<Environment> enclosing, int size);
+        ~Frame();
+        void reset(Ref<Environment> enclosing, int size); // the frame of a tail call
+        Environment& get() { return *environment; }
+        const Ref<Environment>& pointer() { return environment; }
 };
 
 #endif
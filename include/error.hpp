@@ -16,7 +16,7 @@
 class RuntimeError : public std::runtime_error
 {
     public:
-        const Token& token;
+        const Token token;
 
         RuntimeError(const Token& token, std::string msg);
 };
@@ -31,6 +31,7 @@ class Error
         static void error(int line, const std::string& msg);
         static void error(const Token& token, std::string msg);
         static void runtime_error(const RuntimeError& error);
+        static void check_arity(const Token& paren, int arity, size_t argc);
 };
 
 #endif
@@ -9,10 +9,11 @@
 #pragma once
 #include <vector>
 #include <memory>
-#include <any>
 #include <utility>
 
 #include "token.hpp"
+#include "value.hpp"
+#include "cache.hpp"
 
 struct Stmt;
 
@@ -33,167 +34,204 @@ struct ListExpr;
 struct SubscriptExpr;
 
 // visitor struct (for visitor pattern handling)
+// nodes are visited through plain pointers, the tree owns them and outlives every pass over it
 struct ExprVisitor
 {
     virtual ~ExprVisitor() = default;
-    virtual std::any visitAssignExpr(std::shared_ptr<AssignExpr> expr) = 0;
-    virtual std::any visitBinaryExpr(std::shared_ptr<BinaryExpr> expr) = 0;
-    virtual std::any visitGroupingExpr(std::shared_ptr<GroupingExpr> expr) = 0;
-    virtual std::any visitLiteralExpr(std::shared_ptr<LiteralExpr> expr) = 0;
-    virtual std::any visitUnaryExpr(std::shared_ptr<UnaryExpr> expr) = 0;
-    virtual std::any visitMutExpr(std::shared_ptr<MutExpr> expr) = 0;
-    virtual std::any visitLogicalExpr(std::shared_ptr<LogicalExpr> expr) = 0;
-    virtual std::any visitCallExpr(std::shared_ptr<CallExpr> expr) = 0;
-    virtual std::any visitFunctionExpr(std::shared_ptr<FunctionExpr> expr) = 0;
-    virtual std::any visitGetExpr(std::shared_ptr<GetExpr> expr) = 0;
-    virtual std::any visitSetExpr(std::shared_ptr<SetExpr> expr) = 0;
-    virtual std::any visitThisExpr(std::shared_ptr<ThisExpr> expr) = 0;
-    virtual std::any visitSuperExpr(std::shared_ptr<SuperExpr> expr) = 0;
-    virtual std::any visitListExpr(std::shared_ptr<ListExpr> expr) = 0;
-    virtual std::any visitSubscriptExpr(std::shared_ptr<SubscriptExpr> expr) = 0;
+    virtual Value visitAssignExpr(AssignExpr* expr) = 0;
+    virtual Value visitBinaryExpr(BinaryExpr* expr) = 0;
+    virtual Value visitGroupingExpr(GroupingExpr* expr) = 0;
+    virtual Value visitLiteralExpr(LiteralExpr* expr) = 0;
+    virtual Value visitUnaryExpr(UnaryExpr* expr) = 0;
+    virtual Value visitMutExpr(MutExpr* expr) = 0;
+    virtual Value visitLogicalExpr(LogicalExpr* expr) = 0;
+    virtual Value visitCallExpr(CallExpr* expr) = 0;
+    virtual Value visitFunctionExpr(FunctionExpr* expr) = 0;
+    virtual Value visitGetExpr(GetExpr* expr) = 0;
+    virtual Value visitSetExpr(SetExpr* expr) = 0;
+    virtual Value visitThisExpr(ThisExpr* expr) = 0;
+    virtual Value visitSuperExpr(SuperExpr* expr) = 0;
+    virtual Value visitListExpr(ListExpr* expr) = 0;
+    virtual Value visitSubscriptExpr(SubscriptExpr* expr) = 0;
+};
+
+// where the resolver found a variable
+struct LocalSlot
+{
+    int depth = -1; // number of scopes between the use and the declaration, -1 for globals
+    int slot = 0; // index of the variable inside that scope
+    int capture = -1; // index into the running function's captures when an outer function declared it
+
+    bool is_global() const { return depth < 0; }
+};
+
+// a free variable of a function, where a new closure of it finds the variable
+struct Capture
+{
+    bool is_local; // declared around the function, otherwise a capture of the enclosing function
+    int depth; // scopes between the function's declaration and the variable, when is_local
+    int slot; // slot of the variable, when is_local
+    int index; // capture of the enclosing function, when not is_local
+
+    bool operator==(const Capture& other) const = default;
 };
 
 // default expression virtual struct
+// nodes live in the Ast of their module, which destroys them by their own type
 struct Expr
 {
-    virtual ~Expr() = default;
-    virtual std::any accept(ExprVisitor& visitor) = 0;
+    virtual Value accept(ExprVisitor& visitor) = 0;
+
+    protected:
+        ~Expr() = default;
 };
 
-struct AssignExpr : Expr, public std::enable_shared_from_this<AssignExpr>
+struct AssignExpr : Expr
 {
     const Token name;
-    const std::shared_ptr<Expr> value;
+    Expr* const value;
+    LocalSlot local;
 
-    AssignExpr(Token name, std::shared_ptr<Expr> value);
-    std::any accept(ExprVisitor& visitor) override;
+    AssignExpr(Token name, Expr* value);
+    Value accept(ExprVisitor& visitor) override;
 };
 
-struct BinaryExpr : Expr, public std::enable_shared_from_this<BinaryExpr>
+struct BinaryExpr : Expr
 {
-    const std::shared_ptr<Expr> left;
+    Expr* const left;
     const Token op;
-    const std::shared_ptr<Expr> right;
+    Expr* const right;
 
-    BinaryExpr(std::shared_ptr<Expr> left, Token op, std::shared_ptr<Expr> right);
-    std::any accept(ExprVisitor& visitor) override;
+    BinaryExpr(Expr* left, Token op, Expr* right);
+    Value accept(ExprVisitor& visitor) override;
 };
 
-struct GroupingExpr : Expr, public std::enable_shared_from_this<GroupingExpr>
+struct GroupingExpr : Expr
 {
-    const std::shared_ptr<Expr> expression;
+    Expr* const expression;
 
-    GroupingExpr(std::shared_ptr<Expr> expression);
-    std::any accept(ExprVisitor& visitor) override;
+    GroupingExpr(Expr* expression);
+    Value accept(ExprVisitor& visitor) override;
 };
 
-struct LiteralExpr : Expr, public std::enable_shared_from_this<LiteralExpr>
+struct LiteralExpr : Expr
 {
-    std::any value;
+    Value value;
 
-    LiteralExpr(std::any value);
-    std::any accept(ExprVisitor& visitor) override;
+    LiteralExpr(Value value);
+    Value accept(ExprVisitor& visitor) override;
 };
 
-struct UnaryExpr : Expr, public std::enable_shared_from_this<UnaryExpr>
+struct UnaryExpr : Expr
 {
     const Token op;
-    const std::shared_ptr<Expr> right;
+    Expr* const right;
 
-    UnaryExpr(Token op, std::shared_ptr<Expr> right);
-    std::any accept(ExprVisitor& visitor) override;
+    UnaryExpr(Token op, Expr* right);
+    Value accept(ExprVisitor& visitor) override;
 };
 
-struct MutExpr : Expr, public std::enable_shared_from_this<MutExpr>
+struct MutExpr : Expr
 {
     const Token name;
+    LocalSlot local;
 
     MutExpr(Token name);
-    std::any accept(ExprVisitor& visitor) override;
+    Value accept(ExprVisitor& visitor) override;
 };
 
-struct LogicalExpr : Expr, public std::enable_shared_from_this<LogicalExpr>
+struct LogicalExpr : Expr
 {
-    const std::shared_ptr<Expr> left;
+    Expr* const left;
     const Token op;
-    const std::shared_ptr<Expr> right;
+    Expr* const right;
 
-    LogicalExpr(std::shared_ptr<Expr> left, Token op, std::shared_ptr<Expr> right);
-    std::any accept(ExprVisitor& visitor) override;
+    LogicalExpr(Expr* left, Token op, Expr* right);
+    Value accept(ExprVisitor& visitor) override;
 };
 
-struct CallExpr : Expr, public std::enable_shared_from_this<CallExpr>
+struct CallExpr : Expr
 {
-    std::shared_ptr<Expr> callee;
+    Expr* callee;
     Token paren;
-    std::vector<std::shared_ptr<Expr>> arguments;
+    std::vector<Expr*> arguments;
+    GetExpr* method; // the callee, when this calls a method
+    InlineCache cache{InlineCache::call_stats};
+    bool tail = false; // the value of a return statement, the callee can take over the caller's frame, set by the resolver
 
-    CallExpr(std::shared_ptr<Expr> callee, Token paren, std::vector<std::shared_ptr<Expr>> arguments);
-    std::any accept(ExprVisitor& visitor) override;
+    CallExpr(Expr* callee, Token paren, std::vector<Expr*> arguments);
+    Value accept(ExprVisitor& visitor) override;
 };
 
-struct FunctionExpr : Expr, public std::enable_shared_from_this<FunctionExpr>
+struct FunctionExpr : Expr
 {
     std::vector<Token> parameters;
-    std::vector<std::shared_ptr<Stmt>> body;
+    std::vector<Stmt*> body;
+    int slot_count = 0; // parameters plus locals of the body, set by the resolver
+    std::vector<Capture> captures; // free variables, set by the resolver
 
-    FunctionExpr(std::vector<Token> parameters, std::vector<std::shared_ptr<Stmt>> body);
-    std::any accept(ExprVisitor& visitor) override;
+    FunctionExpr(std::vector<Token> parameters, std::vector<Stmt*> body);
+    Value accept(ExprVisitor& visitor) override;
 };
 
-struct GetExpr : Expr, public std::enable_shared_from_this<GetExpr>
+struct GetExpr : Expr
 {
-    const std::shared_ptr<Expr> object;
+    Expr* const object;
     const Token name;
+    InlineCache cache{InlineCache::get_stats};
 
-    GetExpr(std::shared_ptr<Expr> object, Token name);
-    std::any accept(ExprVisitor& visitor) override;
+    GetExpr(Expr* object, Token name);
+    Value accept(ExprVisitor& visitor) override;
 };
 
-struct SetExpr : Expr, public std::enable_shared_from_this<SetExpr>
+struct SetExpr : Expr
 {
-    const std::shared_ptr<Expr> object;
+    Expr* const object;
     const Token name;
-    const std::shared_ptr<Expr> value;
+    Expr* const value;
+    InlineCache cache{InlineCache::set_stats};
 
-    SetExpr(std::shared_ptr<Expr> object, Token name, std::shared_ptr<Expr> value);
-    std::any accept(ExprVisitor& visitor) override;
+    SetExpr(Expr* object, Token name, Expr* value);
+    Value accept(ExprVisitor& visitor) override;
 };
 
-struct ThisExpr : Expr, public std::enable_shared_from_this<ThisExpr>
+struct ThisExpr : Expr
 {
     const Token keyword;
+    LocalSlot local;
 
     ThisExpr(Token keyword);
-    std::any accept(ExprVisitor& visitor) override;
+    Value accept(ExprVisitor& visitor) override;
 };
 
-struct SuperExpr : Expr, public std::enable_shared_from_this<SuperExpr>
+struct SuperExpr : Expr
 {
     const Token keyword;
     const Token method;
+    LocalSlot local;
+    LocalSlot receiver; // 'this' of the method
 
     SuperExpr(Token keyword, Token method);
-    std::any accept(ExprVisitor& visitor) override;
+    Value accept(ExprVisitor& visitor) override;
 };
 
-struct ListExpr : Expr, public std::enable_shared_from_this<ListExpr>
+struct ListExpr : Expr
 {
-    std::vector<std::shared_ptr<Expr>> elements;
+    std::vector<Expr*> elements;
 
-    ListExpr(std::vector<std::shared_ptr<Expr>> elements);
-    std::any accept(ExprVisitor& visitor) override;
+    ListExpr(std::vector<Expr*> elements);
+    Value accept(ExprVisitor& visitor) override;
 };
 
-struct SubscriptExpr : Expr, public std::enable_shared_from_this<SubscriptExpr>
+struct SubscriptExpr : Expr
 {
-    std::shared_ptr<Expr> name;
+    Expr* name;
     Token paren;
-    std::shared_ptr<Expr> index;
-    std::shared_ptr<Expr> value;
+    Expr* index;
+    Expr* value;
 
-    SubscriptExpr(std::shared_ptr<Expr> name, Token paren, std::shared_ptr<Expr> index, std::shared_ptr<Expr> value);
-    std::any accept(ExprVisitor& visitor) override;
+    SubscriptExpr(Expr* name, Token paren, Expr* index, Expr* value);
+    Value accept(ExprVisitor& visitor) override;
 };
 
 #endif
@@ -9,28 +9,31 @@
 #pragma once
 #include "interpreter.hpp"
 #include "instance.hpp"
+#include "closure.hpp"
 
 class NblInstance;
 
-struct NblReturn
-{
-    const std::any value;
-};
-
 class NblFunction : public NblCallable
 {
+    friend class Interpreter;
+
     private:
         std::string name;
-        std::shared_ptr<FunctionExpr> declaration;
-        std::shared_ptr<Environment> closure;
-        bool is_initializer;
+        FunctionExpr* declaration;
+        std::vector<Ref<NblUpvalue>> upvalues; // the free variables, in the order of declaration->captures
+        FunctionType type;
+        Value receiver; // 'this' of a method used as a value, set by bind
 
     public:
-        NblFunction(std::string name, std::shared_ptr<FunctionExpr> declaration, std::shared_ptr<Environment> closure, bool is_initializer);
-        std::shared_ptr<NblFunction> bind(std::shared_ptr<NblInstance> instance);
+        NblFunction(std::string name, FunctionExpr* declaration, std::vector<Ref<NblUpvalue>> upvalues, FunctionType type);
+        Ref<NblFunction> bind(Ref<NblInstance> instance);
         int arity() override;
-        std::any call(Interpreter& interpreter, std::vector<std::any> arguments) override;
+        Value call(Interpreter& interpreter, std::vector<Value> arguments);
+        Value invoke(Interpreter& interpreter, const Value& receiver, std::vector<Value> arguments);
+        Value run(Interpreter& interpreter, Frame& frame);
         std::string to_string() override;
+        void trace(Tracer& tracer) override;
+        void clear() override;
 };
 
 #endif
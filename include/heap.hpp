@@ -0,0 +1,145 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#ifndef HEAP_HPP
+#define HEAP_HPP
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "value.hpp"
+
+struct HeapStats
+{
+    uint64_t minor = 0; // collections of the young objects only
+    uint64_t major = 0; // collections of the whole heap
+    uint64_t promoted = 0; // young objects that survived a minor collection
+    uint64_t freed = 0; // objects found in garbage cycles
+    uint64_t peak = 0; // most objects tracked at once
+    double seconds = 0; // time spent collecting
+    size_t bytes = 0; // objects and the storage they own
+    size_t peak_bytes = 0;
+};
+
+// every object that can hold a reference to another object
+// reference counting frees everything except cycles, a collection finds those by tracing:
+// references counted but not reached from another tracked object come from the outside
+// (environments, value stacks, the engine), so those objects and all they reach stay alive
+// the objects are split in two generations, most cycles die young so usually only the young ones are traced
+class Heap
+{
+    private:
+        static Heap* active; // heap of the engine that builds, runs or frees objects, new objects are made in it
+        static std::vector<Heap*> heaps; // by id, an object keeps the id of the heap it was made in
+
+        uint32_t id;
+        std::vector<Object*> objects; // the old generation first, then the young one
+        size_t old_count = 0; // objects that survived a collection
+        size_t threshold = 10000; // young objects that trigger a minor collection
+        size_t next_major = 10000; // old objects that trigger a major collection
+        size_t limit = 0; // most bytes the program can use, set by --max-heap, 0 for no limit
+        size_t next_pressure = SIZE_MAX; // bytes that trigger a major collection, on the way to the limit
+
+        void add(Object* object);
+        void remove(Object* object);
+        void move(size_t from, size_t to);
+        void collect(size_t start);
+        void update_pressure();
+
+    public:
+        static const uint32_t NONE = UINT32_MAX; // made while no engine ran, not accounted anywhere
+
+        HeapStats stats;
+
+        Heap();
+        Heap(const Heap&) = delete;
+        Heap& operator=(const Heap&) = delete;
+        ~Heap();
+
+        // each engine has a heap of its own, an object is freed into the heap it was made in
+        static Heap* current() { return active; }
+        static uint32_t current_id() { return active != nullptr ? active->id : NONE; }
+        static Heap* of(const Object* object) { return object->heap_id != NONE ? heaps[object->heap_id] : nullptr; }
+        // returns the heap that was current, to be given back
+        static Heap* make_current(Heap* heap) { return std::exchange(active, heap); }
+
+        // current for a scope, the caller's heap comes back after
+        // so a host can build, run and free an engine from the callback of another
+        class Use
+        {
+            private:
+                Heap* saved;
+
+            public:
+                Use(Heap* heap) : saved(make_current(heap)) {}
+                ~Use() { make_current(saved); }
+                Use(const Use&) = delete;
+                Use& operator=(const Use&) = delete;
+        };
+
+        // the old generation can grow to twice what survived the last major collection
+        void set_threshold(size_t objects);
+        void set_limit(size_t bytes);
+        void collect();
+        void print_stats() const;
+        void print_usage() const;
+
+        // an object joins the heap it was made in, and leaves it when it dies
+        static void track(Object* object);
+        static void untrack(Object* object);
+
+        // memory of every runtime object, recycled by size so a short-lived object costs a free list pop
+        // the free lists are shared by all heaps, the memory is charged to the current one
+        static void* allocate(size_t size);
+        static void free(void* memory, size_t size);
+
+        // account memory owned by an object, throws a RuntimeError past the limit
+        void charge(size_t bytes);
+        void refund(size_t bytes) { stats.bytes -= bytes; }
+        static void charge_current(size_t bytes) { if (active != nullptr) active->charge(bytes); }
+        static void refund_current(size_t bytes) { if (active != nullptr) active->refund(bytes); }
+
+        // safe point of the engines, every live object is referenced from somewhere counted
+        void poll()
+        {
+            if (objects.size() - old_count >= threshold || stats.bytes >= next_pressure)
+                collect();
+        }
+};
+
+// allocator of the storage an object keeps outside itself (list elements, fields, slots)
+template <class T>
+struct HeapAllocator
+{
+    using value_type = T;
+
+    HeapAllocator() = default;
+
+    template <class U>
+    HeapAllocator(const HeapAllocator<U>&) {}
+
+    T* allocate(size_t count)
+    {
+        Heap::charge_current(count * sizeof(T));
+        return std::allocator<T>().allocate(count);
+    }
+
+    void deallocate(T* memory, size_t count)
+    {
+        Heap::refund_current(count * sizeof(T));
+        std::allocator<T>().deallocate(memory, count);
+    }
+
+    bool operator==(const HeapAllocator&) const { return true; }
+};
+
+template <class T>
+using HeapVector = std::vector<T, HeapAllocator<T>>;
+
+#endif
@@ -7,28 +7,43 @@
 #define INSTANCE_HPP
 
 #pragma once
-#include <any>
 #include <map>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "class.hpp"
 #include "token.hpp"
+#include "value.hpp"
+#include "shape.hpp"
+#include "heap.hpp"
 
 class NblClass;
 class Token;
 
-class NblInstance : public std::enable_shared_from_this<NblInstance>
+class NblInstance : public Object
 {
+    friend class VM;
+    friend class ClosureCompiler;
+    friend class InlineCache;
+
     private:
-        std::shared_ptr<NblClass> klass;
-        std::map<std::string, std::any> fields;
+        Ref<NblClass> klass;
+        Ref<Shape> shape;
+        HeapVector<Value> fields; // laid out by the shape
+
+        void add_field(Shape* next, Value value);
 
     public:
-        NblInstance(std::shared_ptr<NblClass> klass);
-        std::any get(const Token& name);
-        void set(const Token& name, std::any value);
+        NblInstance(Ref<NblClass> klass);
+        void trace(Tracer& tracer) override;
+        void clear() override;
+        Value* find_field(const std::string& name);
+        void set_field(const std::string& name, Value value);
+        Value& field_at(int offset) { return fields[offset]; }
+        Value get(const Token& name);
+        void set(const Token& name, Value value);
         std::string to_string();
 };
 
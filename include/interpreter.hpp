@@ -11,15 +11,16 @@
 #include <utility>
 #include <vector>
 #include <chrono>
-#include <any>
 #include <memory>
 #include <string>
 #include <stdexcept>
 #include <cmath>
 
+#include "engine.hpp"
 #include "expr.hpp"
 #include "error.hpp"
 #include "token.hpp"
+#include "value.hpp"
 #include "stmt.hpp"
 #include "environment.hpp"
 #include "builtins.hpp"
@@ -30,66 +31,90 @@
 #include "list.hpp"
 #include "util.hpp"
 
-class BreakException : public std::runtime_error
+// sets a variable for the rest of a scope and puts the old value back when it ends,
+// a runtime error unwinding through the scope included
+template <class T>
+class Restore
 {
+    private:
+        T& variable;
+        T saved;
+
     public:
-        BreakException() : std::runtime_error("break") {};
+        Restore(T& variable, T value) : variable(variable), saved(std::exchange(variable, std::move(value))) {}
+        Restore(const Restore&) = delete;
+        Restore& operator=(const Restore&) = delete;
+        ~Restore() { variable = std::move(saved); }
 };
 
-class Interpreter : public ExprVisitor, public StmtVisitor
+class Interpreter : public ExprVisitor, public StmtVisitor, public Engine
 {
+    friend class NblFunction;
+
+    private:
+        // every module run, declared first so the trees outlive the functions pointing into them
+        std::vector<std::unique_ptr<Ast>> modules;
+
     public:
-        std::shared_ptr<Environment> globals{new Environment};
+        Ref<Environment> globals{new Environment};
+        FrameStack frames; // slots of the running calls and blocks
     
     private:
-        std::map<std::shared_ptr<Expr>, int> locals;
-        std::shared_ptr<Environment> environment = globals;
+        Ref<Environment> environment = globals;
+        std::vector<Ref<NblUpvalue>>* upvalues = nullptr; // captures of the running function
+        Value return_value; // value carried by a RETURN completion
+        Value tail_function; // callee of a pending tail call, run by the caller's NblFunction::run
+        Value tail_receiver;
+        std::vector<Value> tail_arguments;
 
     private:
-        std::any lookup_mut(const Token& name, std::shared_ptr<Expr> expr);
-        std::any evaluate(std::shared_ptr<Expr> expr);
-        void execute(std::shared_ptr<Stmt> stmt);
-        void check_num_operand(const Token& op, const std::any& operand);
-        void check_num_operands(const Token& op, const std::any& left, const std::any& right);
-        bool is_truthy(const std::any& obj);
-        bool is_equal(const std::any& obj1, const std::any& obj2);
-        std::string int_or_double(const std::any& obj);
-        std::string stringify(const std::any& obj);
+        Value lookup_mut(const Token& name, const LocalSlot& local);
+        Value& local_at(const LocalSlot& local);
+        Ref<NblFunction> make_function(std::string name, FunctionExpr* fn, FunctionType type);
+        void define(const std::string& name, Value value);
+        Value evaluate(Expr* expr);
+        const CacheEntry& lookup_property(GetExpr* expr, InlineCache& cache, Value& object);
+        Completion execute(Stmt* stmt);
+        Value call_function(NblFunction* function, const Value& receiver, const std::vector<Expr*>& arguments);
+        Value tail_call(NblFunction* function, const Value& receiver, const std::vector<Expr*>& arguments);
+        void check_num_operand(const Token& op, const Value& operand);
+        void check_num_operands(const Token& op, const Value& left, const Value& right);
 
     public:
-        Interpreter();
-        void interpret(const std::vector<std::shared_ptr<Stmt>>& statements);
-        std::string interpret(const std::shared_ptr<Expr>& expr);
-        void execute_block(const std::vector<std::shared_ptr<Stmt>>& statements, std::shared_ptr<Environment> environment);
-        void resolve(std::shared_ptr<Expr> expr, int depth);
+        Interpreter(Heap& heap);
+        ~Interpreter();
+        void interpret(std::unique_ptr<Ast> module) override;
+        std::string interpret_expression(std::unique_ptr<Ast> module) override;
+        Completion execute_block(const std::vector<Stmt*>& statements, Ref<Environment> environment);
+        Value take_return_value();
 
-        std::any visitAssignExpr(std::shared_ptr<AssignExpr> expr) override;
-        std::any visitBinaryExpr(std::shared_ptr<BinaryExpr> expr) override;
-        std::any visitGroupingExpr(std::shared_ptr<GroupingExpr> expr) override;
-        std::any visitLiteralExpr(std::shared_ptr<LiteralExpr> expr) override;
-        std::any visitUnaryExpr(std::shared_ptr<UnaryExpr> expr) override;
-        std::any visitMutExpr(std::shared_ptr<MutExpr> expr) override;
-        std::any visitLogicalExpr(std::shared_ptr<LogicalExpr> expr) override;
-        std::any visitCallExpr(std::shared_ptr<CallExpr> expr) override;
-        std::any visitFunctionExpr(std::shared_ptr<FunctionExpr> expr) override;
-        std::any visitGetExpr(std::shared_ptr<GetExpr> expr) override;
-        std::any visitSetExpr(std::shared_ptr<SetExpr> expr) override;
-        std::any visitThisExpr(std::shared_ptr<ThisExpr> expr) override;
-        std::any visitSuperExpr(std::shared_ptr<SuperExpr> expr) override;
-        std::any visitListExpr(std::shared_ptr<ListExpr> expr) override;
-        std::any visitSubscriptExpr(std::shared_ptr<SubscriptExpr> expr) override;
+        Value visitAssignExpr(AssignExpr* expr) override;
+        Value visitBinaryExpr(BinaryExpr* expr) override;
+        Value visitGroupingExpr(GroupingExpr* expr) override;
+        Value visitLiteralExpr(LiteralExpr* expr) override;
+        Value visitUnaryExpr(UnaryExpr* expr) override;
+        Value visitMutExpr(MutExpr* expr) override;
+        Value visitLogicalExpr(LogicalExpr* expr) override;
+        Value visitCallExpr(CallExpr* expr) override;
+        Value visitFunctionExpr(FunctionExpr* expr) override;
+        Value visitGetExpr(GetExpr* expr) override;
+        Value visitSetExpr(SetExpr* expr) override;
+        Value visitThisExpr(ThisExpr* expr) override;
+        Value visitSuperExpr(SuperExpr* expr) override;
+        Value visitListExpr(ListExpr* expr) override;
+        Value visitSubscriptExpr(SubscriptExpr* expr) override;
 
-        std::any visitBlockStmt(std::shared_ptr<BlockStmt> stmt) override;
-        std::any visitExpressionStmt(std::shared_ptr<ExpressionStmt> stmt) override;
-        std::any visitPrintStmt(std::shared_ptr<PrintStmt> stmt) override;
-        std::any visitMutStmt(std::shared_ptr<MutStmt> stmt) override;
-        std::any visitIfStmt(std::shared_ptr<IfStmt> stmt) override;
-        std::any visitWhileStmt(std::shared_ptr<WhileStmt> stmt) override;
-        std::any visitFunctionStmt(std::shared_ptr<FunctionStmt> stmt) override;
-        std::any visitReturnStmt(std::shared_ptr<ReturnStmt> stmt) override;
-        std::any visitBreakStmt(std::shared_ptr<BreakStmt> stmt) override;
-        std::any visitClassStmt(std::shared_ptr<ClassStmt> stmt) override;
-        std::any visitImportStmt(std::shared_ptr<ImportStmt> stmt) override;
+        Completion visitBlockStmt(BlockStmt* stmt) override;
+        Completion visitExpressionStmt(ExpressionStmt* stmt) override;
+        Completion visitPrintStmt(PrintStmt* stmt) override;
+        Completion visitMutStmt(MutStmt* stmt) override;
+        Completion visitIfStmt(IfStmt* stmt) override;
+        Completion visitWhileStmt(WhileStmt* stmt) override;
+        Completion visitFunctionStmt(FunctionStmt* stmt) override;
+        Completion visitReturnStmt(ReturnStmt* stmt) override;
+        Completion visitBreakStmt(BreakStmt* stmt) override;
+        Completion visitClassStmt(ClassStmt* stmt) override;
+        Completion visitImportStmt(ImportStmt* stmt) override;
 };
 
 #endif
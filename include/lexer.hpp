@@ -9,8 +9,7 @@
 #pragma once
 #include <vector>
 #include <string>
-#include <any>
-#include <map>
+#include <string_view>
 
 #include "token.hpp"
 #include "error.hpp"
@@ -19,14 +18,15 @@ class Lexer
 {
     private:
         // data
-        std::string source;
+        uint32_t source_index;
+        Source& module;
+        std::string_view source; // text of the module, the tokens point into it
         std::vector<Token> tokens;
 
-        static const std::map<std::string, TokenType> keywords;
-
         int start = 0;
         int current = 0;
         int line = 1;
+        int line_start = 0; // offset of the first character of the line, for columns
 
         bool is_at_end() const;
         char advance();
@@ -34,7 +34,6 @@ class Lexer
         char peek();
         char peek_next();
 
-        void add_token(TokenType type, std::any literal);
         void add_token(TokenType type);
 
         void string();
@@ -43,7 +42,7 @@ class Lexer
         void scan_token();
 
     public:
-        Lexer(std::string source);
+        Lexer(uint32_t source);
         std::vector<Token> scan_tokens();
 };
 
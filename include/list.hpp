@@ -8,17 +8,20 @@
 
 #pragma once
 #include <vector>
-#include <any>
 
-#include "expr.hpp"
+#include "value.hpp"
+#include "heap.hpp"
 
-struct ListType
+struct ListType : Object
 {
-    std::vector<std::any> elements;
+    HeapVector<Value> elements;
 
-    void append(std::any value);
-    std::any get_element_at(int index);
-    bool set_element_at(int index, std::any value);
+    ListType();
+    void trace(Tracer& tracer) override;
+    void clear() override;
+    void append(Value value);
+    Value get_element_at(int index);
+    bool set_element_at(int index, Value value);
     int get_length();
 };
 
@@ -10,10 +10,12 @@
 #include <vector>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <stdexcept>
 #include <cassert>
 #include <utility>
 
+#include "ast.hpp"
 #include "expr.hpp"
 #include "error.hpp"
 #include "token.hpp"
@@ -28,62 +30,63 @@ struct ParseError : public std::runtime_error
 class Parser
 {
     const std::vector<Token>& tokens;
+    Ast& ast; // module the nodes are made in
     int current = 0;
     int loop_depth = 0; // track how many enclosing loops
 
     private:
-        bool allow_expression;
+        bool allow_expression = false; // only prompt lines can be a bare expression
         bool found_expression = false;
 
-        std::shared_ptr<Stmt> statement();
-        std::shared_ptr<Stmt> print_statement();
-        std::shared_ptr<Stmt> if_statement();
-        std::shared_ptr<Stmt> for_statement();
-        std::shared_ptr<Stmt> while_statement();
-        std::shared_ptr<Stmt> return_statement();
-        std::shared_ptr<Stmt> break_statement();
-        std::shared_ptr<Stmt> import_statement();
-        std::shared_ptr<Stmt> expression_statement();
-        std::vector<std::shared_ptr<Stmt>> block();
-        std::shared_ptr<Stmt> declaration();
-        std::shared_ptr<Stmt> mut_declaration();
-        std::shared_ptr<Stmt> class_declaration();
-        std::shared_ptr<FunctionStmt> function(std::string kind);
-        std::shared_ptr<FunctionExpr> function_body(std::string kind);
+        Stmt* statement();
+        Stmt* print_statement();
+        Stmt* if_statement();
+        Stmt* for_statement();
+        Stmt* while_statement();
+        Stmt* return_statement();
+        Stmt* break_statement();
+        Stmt* import_statement();
+        Stmt* expression_statement();
+        std::vector<Stmt*> block();
+        Stmt* declaration();
+        Stmt* mut_declaration();
+        Stmt* class_declaration();
+        FunctionStmt* function(std::string kind);
+        FunctionExpr* function_body(std::string kind);
 
-        std::shared_ptr<Expr> assignment();
-        std::shared_ptr<Expr> compound(std::shared_ptr<Expr> expr, Token op);
-        std::shared_ptr<Expr> expression();
-        std::shared_ptr<Expr> or_expression();
-        std::shared_ptr<Expr> and_expression();
-        std::shared_ptr<Expr> equality();
-        std::shared_ptr<Expr> comparison();
-        std::shared_ptr<Expr> exponent();
-        std::shared_ptr<Expr> term();
-        std::shared_ptr<Expr> factor();
-        std::shared_ptr<Expr> unary();
-        std::shared_ptr<Expr> finish_subscript(std::shared_ptr<Expr> name);
-        std::shared_ptr<Expr> subscript();
-        std::shared_ptr<Expr> finish_call(std::shared_ptr<Expr> callee);
-        std::shared_ptr<Expr> call();
-        std::shared_ptr<Expr> list_expression();
-        std::shared_ptr<Expr> primary();
+        Expr* assignment();
+        Expr* compound(Expr* expr, Token op);
+        Expr* expression();
+        Expr* or_expression();
+        Expr* and_expression();
+        Expr* equality();
+        Expr* comparison();
+        Expr* exponent();
+        Expr* term();
+        Expr* factor();
+        Expr* unary();
+        Expr* finish_subscript(Expr* name);
+        Expr* subscript();
+        Expr* finish_call(Expr* callee);
+        Expr* call();
+        Expr* list_expression();
+        Expr* primary();
 
         template <class... T>
         bool match(T... type);
-        Token consume(TokenType type, std::string msg);
+        const Token& consume(TokenType type, std::string_view msg);
         bool check(TokenType type);
-        Token advance();
+        const Token& advance();
         bool is_at_end();
-        Token peek();
-        Token previous();
+        const Token& peek();
+        const Token& previous();
         ParseError error(const Token& token, std::string msg);
         void synchronize();
 
     public:
-        Parser(const std::vector<Token>& tokens);
-        std::vector<std::shared_ptr<Stmt>> parse();
-        std::any parse_repl();
+        Parser(const std::vector<Token>& tokens, Ast& ast);
+        void parse();
+        void parse_repl();
 };
 
 #endif
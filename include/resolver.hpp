@@ -9,6 +9,7 @@
 #pragma once
 #include <vector>
 #include <map>
+#include <string_view>
 #include <filesystem>
 #include <fstream>
 
@@ -19,15 +20,6 @@
 
 namespace fs = std::filesystem;
 
-// function types for resolution
-enum class FunctionType
-{
-    NONE,
-    FUNCTION,
-    INITIALIZER,
-    METHOD
-};
-
 // class types for resolution
 enum class ClassType
 {
@@ -36,11 +28,26 @@ enum class ClassType
     SUBCLASS
 };
 
+// a variable declared in a local scope
+struct ScopeVar
+{
+    bool defined; // false while its initializer is being resolved
+    int slot; // index into the environment of the scope
+};
+
 class Resolver : public ExprVisitor, public StmtVisitor
 {
     private:
-        Interpreter& interpreter;
-        std::vector<std::map<std::string, bool>> scopes;
+        std::vector<std::map<std::string, ScopeVar, std::less<>>> scopes;
+
+        // a function being resolved and the index of its own scope
+        struct FunctionScope
+        {
+            FunctionExpr* fn;
+            int scope;
+        };
+
+        std::vector<FunctionScope> functions;
         FunctionType current_func = FunctionType::NONE;
         ClassType current_class = ClassType::NONE;
 
@@ -50,46 +57,47 @@ class Resolver : public ExprVisitor, public StmtVisitor
 
         fs::path get_base_path();
 
-        void resolve(std::shared_ptr<Stmt> stmt);
-        void resolve(std::shared_ptr<Expr> expr);
-        void resolve_function(std::shared_ptr<FunctionExpr> fn, FunctionType type);
-        void resolve_local(std::shared_ptr<Expr> expr, const Token& name);
+        void resolve(Stmt* stmt);
+        void resolve(Expr* expr);
+        void resolve_function(FunctionExpr* fn, FunctionType type);
+        void resolve_local(LocalSlot& local, std::string_view name);
+        int add_capture(int function, int scope, int slot);
         void declare(const Token& name);
         void define(const Token& name);
         void begin_scope();
         void end_scope();
 
     public:
-        Resolver(Interpreter& interpreter, std::string& executed_path);
-        void resolve(const std::vector<std::shared_ptr<Stmt>>& statements);
-
-        std::any visitAssignExpr(std::shared_ptr<AssignExpr> expr) override;
-        std::any visitBinaryExpr(std::shared_ptr<BinaryExpr> expr) override;
-        std::any visitGroupingExpr(std::shared_ptr<GroupingExpr> expr) override;
-        std::any visitLiteralExpr(std::shared_ptr<LiteralExpr> expr) override;
-        std::any visitUnaryExpr(std::shared_ptr<UnaryExpr> expr) override;
-        std::any visitMutExpr(std::shared_ptr<MutExpr> expr) override;
-        std::any visitLogicalExpr(std::shared_ptr<LogicalExpr> expr) override;
-        std::any visitCallExpr(std::shared_ptr<CallExpr> expr) override;
-        std::any visitFunctionExpr(std::shared_ptr<FunctionExpr> expr) override;
-        std::any visitGetExpr(std::shared_ptr<GetExpr> expr) override;
-        std::any visitSetExpr(std::shared_ptr<SetExpr> expr) override;
-        std::any visitThisExpr(std::shared_ptr<ThisExpr> expr) override;
-        std::any visitSuperExpr(std::shared_ptr<SuperExpr> expr) override;
-        std::any visitListExpr(std::shared_ptr<ListExpr> expr) override;
-        std::any visitSubscriptExpr(std::shared_ptr<SubscriptExpr> expr) override;
-
-        std::any visitBlockStmt(std::shared_ptr<BlockStmt> stmt) override;
-        std::any visitExpressionStmt(std::shared_ptr<ExpressionStmt> stmt) override;
-        std::any visitPrintStmt(std::shared_ptr<PrintStmt> stmt) override;
-        std::any visitMutStmt(std::shared_ptr<MutStmt> stmt) override;
-        std::any visitIfStmt(std::shared_ptr<IfStmt> stmt) override;
-        std::any visitWhileStmt(std::shared_ptr<WhileStmt> stmt) override;
-        std::any visitFunctionStmt(std::shared_ptr<FunctionStmt> stmt) override;
-        std::any visitReturnStmt(std::shared_ptr<ReturnStmt> stmt) override;
-        std::any visitBreakStmt(std::shared_ptr<BreakStmt> stmt) override;
-        std::any visitClassStmt(std::shared_ptr<ClassStmt> stmt) override;
-        std::any visitImportStmt(std::shared_ptr<ImportStmt> stmt) override;
+        Resolver(std::string& executed_path);
+        void resolve(const std::vector<Stmt*>& statements);
+
+        Value visitAssignExpr(AssignExpr* expr) override;
+        Value visitBinaryExpr(BinaryExpr* expr) override;
+        Value visitGroupingExpr(GroupingExpr* expr) override;
+        Value visitLiteralExpr(LiteralExpr* expr) override;
+        Value visitUnaryExpr(UnaryExpr* expr) override;
+        Value visitMutExpr(MutExpr* expr) override;
+        Value visitLogicalExpr(LogicalExpr* expr) override;
+        Value visitCallExpr(CallExpr* expr) override;
+        Value visitFunctionExpr(FunctionExpr* expr) override;
+        Value visitGetExpr(GetExpr* expr) override;
+        Value visitSetExpr(SetExpr* expr) override;
+        Value visitThisExpr(ThisExpr* expr) override;
+        Value visitSuperExpr(SuperExpr* expr) override;
+        Value visitListExpr(ListExpr* expr) override;
+        Value visitSubscriptExpr(SubscriptExpr* expr) override;
+
+        Completion visitBlockStmt(BlockStmt* stmt) override;
+        Completion visitExpressionStmt(ExpressionStmt* stmt) override;
+        Completion visitPrintStmt(PrintStmt* stmt) override;
+        Completion visitMutStmt(MutStmt* stmt) override;
+        Completion visitIfStmt(IfStmt* stmt) override;
+        Completion visitWhileStmt(WhileStmt* stmt) override;
+        Completion visitFunctionStmt(FunctionStmt* stmt) override;
+        Completion visitReturnStmt(ReturnStmt* stmt) override;
+        Completion visitBreakStmt(BreakStmt* stmt) override;
+        Completion visitClassStmt(ClassStmt* stmt) override;
+        Completion visitImportStmt(ImportStmt* stmt) override;
 };
 
 #endif
@@ -0,0 +1,29 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#ifndef SHAPE_HPP
+#define SHAPE_HPP
+
+#pragma once
+#include <string>
+#include <unordered_map>
+
+#include "value.hpp"
+
+// layout of an instance's fields (a hidden class)
+// instances of a class that gained the same fields in the same order share one shape
+class Shape : public Object
+{
+    private:
+        std::unordered_map<std::string, int> offsets;
+        std::unordered_map<std::string, Ref<Shape>> transitions; // shapes with one more field
+
+    public:
+        int find(const std::string& name) const;
+        Shape* add(const std::string& name);
+        int size() const;
+};
+
+#endif
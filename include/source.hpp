@@ -0,0 +1,40 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#ifndef SOURCE_HPP
+#define SOURCE_HPP
+
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// the text of a module, tokens refer into it by offset instead of copying their lexemes
+// every source stays for the whole program: trees, compiled code and runtime errors all hold tokens
+class Source
+{
+    private:
+        static std::deque<Source> sources; // the first one is empty, for tokens that don't come from a file
+        static std::vector<const char*> texts; // where each text starts, a token finds its lexeme in one load
+
+        std::string owned; // text that didn't come from a mapped file
+
+        static uint32_t add_view(std::string_view text);
+
+    public:
+        std::string_view text; // a mapped file or owned
+        std::vector<double> numbers; // values of the number literals, side table of Token::literal
+
+        // the index of the new source, for Token::source
+        static uint32_t add(std::string text);
+        // maps the file instead of reading it, a file that can't be opened is empty
+        static uint32_t load(const std::string& path);
+        static Source& get(uint32_t index) { return sources[index]; }
+        static const char* text_of(uint32_t index) { return texts[index]; }
+};
+
+#endif
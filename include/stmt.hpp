@@ -7,12 +7,12 @@
 #define STMT_HPP
 
 #pragma once
-#include <any>
 #include <memory>
 #include <vector>
 #include <utility>
 
 #include "token.hpp"
+#include "value.hpp"
 #include "expr.hpp"
 
 struct BlockStmt;
@@ -27,121 +27,133 @@ struct BreakStmt;
 struct ClassStmt;
 struct ImportStmt;
 
+// how a statement finished, 'return' and 'break' unwind by handing this back
+enum class Completion
+{
+    NORMAL,
+    RETURN,
+    BREAK
+};
+
 struct StmtVisitor
 {
     virtual ~StmtVisitor() = default;
-    virtual std::any visitBlockStmt(std::shared_ptr<BlockStmt> stmt) = 0;
-    virtual std::any visitExpressionStmt(std::shared_ptr<ExpressionStmt> stmt) = 0;
-    virtual std::any visitPrintStmt(std::shared_ptr<PrintStmt> stmt) = 0;
-    virtual std::any visitMutStmt(std::shared_ptr<MutStmt> stmt) = 0;
-    virtual std::any visitIfStmt(std::shared_ptr<IfStmt> stmt) = 0;
-    virtual std::any visitWhileStmt(std::shared_ptr<WhileStmt> stmt) = 0;
-    virtual std::any visitFunctionStmt(std::shared_ptr<FunctionStmt> stmt) = 0;
-    virtual std::any visitReturnStmt(std::shared_ptr<ReturnStmt> stmt) = 0;
-    virtual std::any visitBreakStmt(std::shared_ptr<BreakStmt> stmt) = 0;
-    virtual std::any visitClassStmt(std::shared_ptr<ClassStmt> stmt) = 0;
-    virtual std::any visitImportStmt(std::shared_ptr<ImportStmt> stmt) = 0;
+    virtual Completion visitBlockStmt(BlockStmt* stmt) = 0;
+    virtual Completion visitExpressionStmt(ExpressionStmt* stmt) = 0;
+    virtual Completion visitPrintStmt(PrintStmt* stmt) = 0;
+    virtual Completion visitMutStmt(MutStmt* stmt) = 0;
+    virtual Completion visitIfStmt(IfStmt* stmt) = 0;
+    virtual Completion visitWhileStmt(WhileStmt* stmt) = 0;
+    virtual Completion visitFunctionStmt(FunctionStmt* stmt) = 0;
+    virtual Completion visitReturnStmt(ReturnStmt* stmt) = 0;
+    virtual Completion visitBreakStmt(BreakStmt* stmt) = 0;
+    virtual Completion visitClassStmt(ClassStmt* stmt) = 0;
+    virtual Completion visitImportStmt(ImportStmt* stmt) = 0;
 };
 
+// nodes live in the Ast of their module, which destroys them by their own type
 struct Stmt
 {
-    virtual ~Stmt() = default;
-    virtual std::any accept(StmtVisitor& visitor) = 0;
+    virtual Completion accept(StmtVisitor& visitor) = 0;
+
+    protected:
+        ~Stmt() = default;
 };
 
-struct BlockStmt : Stmt, public std::enable_shared_from_this<BlockStmt>
+struct BlockStmt : Stmt
 {
-    const std::vector<std::shared_ptr<Stmt>> statements;
+    const std::vector<Stmt*> statements;
+    int slot_count = 0; // locals declared directly in the block, set by the resolver
 
-    BlockStmt(std::vector<std::shared_ptr<Stmt>> statements);
-    std::any accept(StmtVisitor& visitor) override;
+    BlockStmt(std::vector<Stmt*> statements);
+    Completion accept(StmtVisitor& visitor) override;
 };
 
-struct ExpressionStmt : Stmt, public std::enable_shared_from_this<ExpressionStmt>
+struct ExpressionStmt : Stmt
 {
-    const std::shared_ptr<Expr> expression;
+    Expr* const expression;
 
-    ExpressionStmt(std::shared_ptr<Expr> expression);
-    std::any accept(StmtVisitor& visitor) override;
+    ExpressionStmt(Expr* expression);
+    Completion accept(StmtVisitor& visitor) override;
 };
 
-struct PrintStmt : Stmt, public std::enable_shared_from_this<PrintStmt>
+struct PrintStmt : Stmt
 {
-    const std::shared_ptr<Expr> expression;
+    Expr* const expression;
 
-    PrintStmt(std::shared_ptr<Expr> expression);
-    std::any accept(StmtVisitor& visitor) override;
+    PrintStmt(Expr* expression);
+    Completion accept(StmtVisitor& visitor) override;
 };
 
-struct MutStmt : Stmt, public std::enable_shared_from_this<MutStmt>
+struct MutStmt : Stmt
 {
     const Token name;
-    const std::shared_ptr<Expr> initializer;
+    Expr* const initializer;
 
-    MutStmt(Token name, std::shared_ptr<Expr> initializer);
-    std::any accept(StmtVisitor& visitor) override;
+    MutStmt(Token name, Expr* initializer);
+    Completion accept(StmtVisitor& visitor) override;
 };
 
-struct IfStmt : Stmt, public std::enable_shared_from_this<IfStmt>
+struct IfStmt : Stmt
 {
-    std::shared_ptr<Expr> condition;
-    std::shared_ptr<Stmt> then_branch;
-    std::shared_ptr<Stmt> else_branch;
+    Expr* condition;
+    Stmt* then_branch;
+    Stmt* else_branch;
 
-    IfStmt(std::shared_ptr<Expr> condition, std::shared_ptr<Stmt> then_branch, std::shared_ptr<Stmt> else_branch);
-    std::any accept(StmtVisitor& visitor) override;
+    IfStmt(Expr* condition, Stmt* then_branch, Stmt* else_branch);
+    Completion accept(StmtVisitor& visitor) override;
 };
 
-struct WhileStmt : Stmt, public std::enable_shared_from_this<WhileStmt>
+struct WhileStmt : Stmt
 {
-    std::shared_ptr<Expr> condition;
-    std::shared_ptr<Stmt> body;
+    Expr* condition;
+    Stmt* body;
 
-    WhileStmt(std::shared_ptr<Expr> condition, std::shared_ptr<Stmt> body);
-    std::any accept(StmtVisitor& visitor) override;
+    WhileStmt(Expr* condition, Stmt* body);
+    Completion accept(StmtVisitor& visitor) override;
 };
 
-struct FunctionStmt : Stmt, public std::enable_shared_from_this<FunctionStmt>
+struct FunctionStmt : Stmt
 {
     Token name;
-    std::shared_ptr<FunctionExpr> fn;
+    FunctionExpr* fn;
 
-    FunctionStmt(Token name, std::shared_ptr<FunctionExpr> fn);
-    std::any accept(StmtVisitor& visitor) override;
+    FunctionStmt(Token name, FunctionExpr* fn);
+    Completion accept(StmtVisitor& visitor) override;
 };
 
-struct ReturnStmt : Stmt, public std::enable_shared_from_this<ReturnStmt>
+struct ReturnStmt : Stmt
 {
     const Token keyword;
-    const std::shared_ptr<Expr> value;
+    Expr* const value;
 
-    ReturnStmt(Token keyword, std::shared_ptr<Expr> value);
-    std::any accept(StmtVisitor& visitor) override;
+    ReturnStmt(Token keyword, Expr* value);
+    Completion accept(StmtVisitor& visitor) override;
 };
 
-struct BreakStmt : Stmt, public std::enable_shared_from_this<BreakStmt>
+struct BreakStmt : Stmt
 {
     BreakStmt();
-    std::any accept(StmtVisitor& visitor) override;
+    Completion accept(StmtVisitor& visitor) override;
 };
 
-struct ClassStmt : Stmt, public std::enable_shared_from_this<ClassStmt>
+struct ClassStmt : Stmt
 {
     const Token name;
-    const std::shared_ptr<MutExpr> superclass;
-    const std::vector<std::shared_ptr<FunctionStmt>> methods;
+    MutExpr* const superclass;
+    const std::vector<FunctionStmt*> methods;
 
-    ClassStmt(Token name, std::shared_ptr<MutExpr> superclass, std::vector<std::shared_ptr<FunctionStmt>> methods);
-    std::any accept(StmtVisitor& visitor) override;
+    ClassStmt(Token name, MutExpr* superclass, std::vector<FunctionStmt*> methods);
+    Completion accept(StmtVisitor& visitor) override;
 };
 
-struct ImportStmt : Stmt, public std::enable_shared_from_this<ImportStmt>
+struct ImportStmt : Stmt
 {
     Token keyword;
-    std::shared_ptr<LiteralExpr> target;
+    LiteralExpr* target;
 
-    ImportStmt(Token keyword, std::shared_ptr<LiteralExpr> target);
-    std::any accept(StmtVisitor& visitor) override;
+    ImportStmt(Token keyword, LiteralExpr* target);
+    Completion accept(StmtVisitor& visitor) override;
 };
 
 #endif
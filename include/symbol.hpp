@@ -0,0 +1,26 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#ifndef SYMBOL_HPP
+#define SYMBOL_HPP
+
+#pragma once
+#include <string>
+#include <unordered_map>
+
+// a name interned once, tables keyed by names can index on it instead of hashing strings
+using Symbol = int;
+
+class SymbolTable
+{
+    private:
+        static std::unordered_map<std::string, Symbol>& symbols();
+
+    public:
+        static Symbol intern(const std::string& name);
+        static Symbol find(const std::string& name);
+};
+
+#endif
@@ -7,10 +7,13 @@
 #define TOKEN_HPP
 
 #pragma once
+#include <cstdint>
 #include <string>
-#include <any>
+#include <string_view>
 
-enum TokenType
+#include "source.hpp"
+
+enum TokenType : uint8_t
 {
     // single character tokens
     LEFT_PAREN, RIGHT_PAREN, LEFT_BRACE, RIGHT_BRACE, LEFT_BRACKET, RIGHT_BRACKET,
@@ -37,15 +40,25 @@ enum TokenType
 
 extern std::string token_to_string(TokenType type);
 
+// a token points into the text of its module, copying one copies a few integers
 class Token
 {
     public:
         TokenType type;
-        std::string lexeme;
-        std::any literal;
+        uint16_t column; // of the first character, in bytes
         int line;
+        uint32_t offset; // where the lexeme starts in the source
+        uint32_t length;
+        uint32_t source; // index of the module's Source, 0 for tokens made by the interpreter
+        uint32_t literal = 0; // number literals, index of the value in the source's side table
+
+        // a token with no text, for errors that don't come from the source
+        Token(TokenType type, int line);
+        Token(TokenType type, uint32_t source, uint32_t offset, uint32_t length, int line, uint16_t column);
 
-        Token(TokenType type, std::string lexeme, std::any literal, int line);
+        std::string_view lexeme() const { return std::string_view(Source::text_of(source) + offset, length); }
+        double number() const { return Source::get(source).numbers[literal]; }
+        std::string_view string() const { return lexeme().substr(1, length - 2); } // without the quotes
         std::string to_string() const;
 };
 
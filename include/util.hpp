@@ -13,6 +13,7 @@
 #include <cstring>
 #include <any>
 #include <memory>
+#include <chrono>
 #include "filesystem"
 
 #include "lexer.hpp"
@@ -20,14 +21,28 @@
 #include "parser.hpp"
 #include "stmt.hpp"
 #include "resolver.hpp"
+#include "engine.hpp"
 #include "interpreter.hpp"
 
 #define ANSI_RED "\033[0;31m"
 #define ANSI_CYAN "\033[0;36m"
 #define ANSI_RESET "\033[0m"
 
-extern void run(const std::string& text, Interpreter& interpreter);
-extern void run_file(const std::string& filename, Interpreter& interpreter);
-extern void run_prompt(Interpreter& interpreter);
+// time spent getting modules ready to run in milliseconds, summed over the script and its imports
+struct PhaseTimes
+{
+    static double load;
+    static double lex;
+    static double parse;
+    static double resolve;
+
+    static void print(); // printed by --phase-times
+};
+
+extern uint32_t load_file(const std::string& path);
+extern std::unique_ptr<Ast> parse(uint32_t source, std::string base_dir);
+extern void run(uint32_t source, Engine& engine, std::string base_dir);
+extern void run_file(const std::string& filename, Engine& engine);
+extern void run_prompt(Engine& engine);
 
 #endif
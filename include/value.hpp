@@ -0,0 +1,236 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#ifndef VALUE_HPP
+#define VALUE_HPP
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <string>
+#include <utility>
+
+class NblNative;
+class NblFunction;
+class NblClosure;
+class NblBoundMethod;
+class NblCompiledFunction;
+class NblClass;
+class NblInstance;
+struct ListType;
+
+// one tag per runtime type, so checking a type is a single compare
+enum class ValueType : uint8_t
+{
+    NIL,
+    BOOL,
+    NUMBER,
+    STRING,
+    LIST,
+    INSTANCE,
+    FUNCTION,
+    CLASS,
+    NATIVE,
+    CLOSURE, // function compiled for the vm
+    BOUND_METHOD, // vm method paired with its receiver
+    COMPILED_FUNCTION // function compiled into closures
+};
+
+class Tracer;
+
+// base of every heap allocated runtime object
+// objects are reference counted intrusively (no control block, no atomics)
+// objects that can hold other objects are also tracked by the heap, which collects the cycles counting misses
+class Object
+{
+    friend class Heap;
+
+    private:
+        uint32_t refcount = 0;
+        uint32_t gc_refs = 0; // references from outside the heap, worked out while collecting
+        uint32_t heap_index = UNTRACKED; // position in the heap's object list
+        uint32_t heap_id; // heap it was made in
+
+        static const uint32_t UNTRACKED = UINT32_MAX;
+
+    public:
+        Object();
+        virtual ~Object();
+
+        static void* operator new(size_t size);
+        // the object and all it owns are freed with the heap it was made in current
+        static void operator delete(Object* object, std::destroying_delete_t, size_t size);
+        static void operator delete(void* memory, size_t size); // a constructor threw
+
+        void retain() { ++refcount; }
+        void release()
+        {
+            if (--refcount == 0)
+                delete this;
+        }
+
+        // visit every object this one holds a counted reference to
+        virtual void trace(Tracer& tracer) {}
+
+        // drop those references, breaks a cycle found to be garbage
+        virtual void clear() {}
+};
+
+struct NblString : Object
+{
+    const std::string chars;
+
+    NblString(std::string chars);
+    ~NblString();
+};
+
+// owning pointer to a runtime object
+template <class T>
+class Ref
+{
+    private:
+        T* ptr = nullptr;
+
+    public:
+        Ref() = default;
+        Ref(std::nullptr_t) {}
+        Ref(T* ptr) : ptr(ptr) { if (ptr != nullptr) ptr->retain(); }
+        Ref(const Ref& other) : Ref(other.ptr) {}
+        Ref(Ref&& other) noexcept : ptr(other.ptr) { other.ptr = nullptr; }
+
+        template <class U>
+        Ref(const Ref<U>& other) : Ref(other.get()) {}
+
+        ~Ref() { if (ptr != nullptr) ptr->release(); }
+
+        Ref& operator=(Ref other) noexcept
+        {
+            std::swap(ptr, other.ptr);
+            return *this;
+        }
+
+        T* get() const { return ptr; }
+        T* operator->() const { return ptr; }
+        T& operator*() const { return *ptr; }
+        bool operator==(const Ref& other) const { return ptr == other.ptr; }
+        bool operator==(std::nullptr_t) const { return ptr == nullptr; }
+        bool operator!=(std::nullptr_t) const { return ptr != nullptr; }
+};
+
+// 16 byte tagged value: a tag plus a double, a bool or an object pointer
+class Value
+{
+    private:
+        ValueType type = ValueType::NIL;
+
+        union
+        {
+            bool boolean;
+            double number;
+            Object* object;
+        } as{};
+
+        Value(ValueType type, Object* object);
+
+        void retain() const { if (is_object()) as.object->retain(); }
+        void release() const { if (is_object()) as.object->release(); }
+
+    public:
+        Value() = default;
+        Value(std::nullptr_t) {}
+        Value(bool boolean) : type(ValueType::BOOL) { as.boolean = boolean; }
+        Value(double number) : type(ValueType::NUMBER) { as.number = number; }
+        Value(const char* chars);
+        Value(std::string chars);
+        Value(NblString* string);
+        Value(ListType* list);
+        Value(NblInstance* instance);
+        Value(NblFunction* function);
+        Value(NblClass* klass);
+        Value(NblNative* native);
+        Value(NblClosure* closure);
+        Value(NblBoundMethod* method);
+        Value(NblCompiledFunction* function);
+
+        template <class T>
+        Value(const Ref<T>& ref) : Value(ref.get()) {}
+
+        Value(const Value& other) : type(other.type), as(other.as) { retain(); }
+        Value(Value&& other) noexcept : type(other.type), as(other.as) { other.type = ValueType::NIL; }
+        ~Value() { release(); }
+
+        Value& operator=(const Value& other)
+        {
+            other.retain();
+            release();
+            type = other.type;
+            as = other.as;
+            return *this;
+        }
+
+        Value& operator=(Value&& other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                type = other.type;
+                as = other.as;
+                other.type = ValueType::NIL;
+            }
+            return *this;
+        }
+
+        ValueType get_type() const { return type; }
+        bool is_nil() const { return type == ValueType::NIL; }
+        bool is_bool() const { return type == ValueType::BOOL; }
+        bool is_number() const { return type == ValueType::NUMBER; }
+        bool is_string() const { return type == ValueType::STRING; }
+        bool is_list() const { return type == ValueType::LIST; }
+        bool is_instance() const { return type == ValueType::INSTANCE; }
+        bool is_function() const { return type == ValueType::FUNCTION; }
+        bool is_class() const { return type == ValueType::CLASS; }
+        bool is_native() const { return type == ValueType::NATIVE; }
+        bool is_closure() const { return type == ValueType::CLOSURE; }
+        bool is_bound_method() const { return type == ValueType::BOUND_METHOD; }
+        bool is_compiled_function() const { return type == ValueType::COMPILED_FUNCTION; }
+        bool is_object() const { return type >= ValueType::STRING; }
+
+        bool as_bool() const { return as.boolean; }
+        double as_number() const { return as.number; }
+        const std::string& as_string() const { return static_cast<NblString*>(as.object)->chars; }
+
+        // unchecked downcast, the tag must be checked first
+        template <class T>
+        T* as_object() const { return static_cast<T*>(as.object); }
+};
+
+// walks the references of an object, see Object::trace
+class Tracer
+{
+    public:
+        virtual void visit(Object* object) = 0;
+
+        void visit(const Value& value)
+        {
+            if (value.is_object())
+                visit(value.as_object<Object>());
+        }
+
+        template <class T>
+        void visit(const Ref<T>& ref)
+        {
+            if (ref != nullptr)
+                visit(static_cast<Object*>(ref.get()));
+        }
+};
+
+// semantics shared by every engine
+bool is_truthy(const Value& obj);
+bool is_equal(const Value& obj1, const Value& obj2);
+std::string int_or_double(double number);
+std::string stringify(const Value& obj);
+
+#endif
@@ -0,0 +1,88 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#ifndef VM_HPP
+#define VM_HPP
+
+#pragma once
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <cmath>
+
+#include "engine.hpp"
+#include "error.hpp"
+#include "value.hpp"
+#include "chunk.hpp"
+#include "closure.hpp"
+#include "compiler.hpp"
+#include "builtins.hpp"
+#include "class.hpp"
+#include "instance.hpp"
+#include "list.hpp"
+
+// stack based bytecode engine, selected with --engine=vm
+class VM : public Engine
+{
+    private:
+        // globals are late bound by name, the compiler interns each name to a slot
+        struct Global
+        {
+            std::string name;
+            Value value;
+            bool defined = false;
+        };
+
+        struct CallFrame
+        {
+            NblClosure* closure; // kept alive by slot 0, or by the receiver's class for methods
+            const uint8_t* ip;
+            Value* slots;
+        };
+
+        // both stacks start small and grow on demand, the frames up to --max-call-depth
+        static const size_t FRAMES_INITIAL = 64;
+        static const size_t STACK_INITIAL = 1024;
+
+        std::unique_ptr<Value[]> stack{new Value[STACK_INITIAL]};
+        size_t stack_size = STACK_INITIAL;
+        Value* stack_top = stack.get();
+        std::unique_ptr<CallFrame[]> frames{new CallFrame[FRAMES_INITIAL]};
+        size_t frames_size = FRAMES_INITIAL;
+        size_t frame_count = 0;
+        NblUpvalue* open_upvalues = nullptr; // sorted by stack slot, highest first
+        std::vector<Global> globals;
+        std::unordered_map<std::string, int> global_slots;
+
+        Value execute(Ref<NblPrototype> script);
+        Value run();
+        void call_value(int argc, const uint8_t* ip);
+        void call_closure(NblClosure* closure, int argc, const uint8_t* ip);
+        void tail_call(Value method, int argc, const uint8_t* ip);
+        void push_frame(NblClosure* closure, Value* slots, const uint8_t* ip);
+        void grow_stack(size_t size);
+        void import_file(const std::string& path, const uint8_t* ip);
+        NblUpvalue* capture_upvalue(Value* local);
+        void close_upvalues(Value* last);
+        void reset();
+        Token call_site(const uint8_t* ip); // where the instruction before ip came from
+        [[noreturn]] void runtime_error(const uint8_t* ip, const std::string& msg);
+        void define_native(const std::string& name, NblNative* native);
+
+        void push(Value value) { *stack_top++ = std::move(value); }
+        Value pop() { return std::move(*--stack_top); }
+        void discard() { *--stack_top = Value(); }
+
+    public:
+        VM(Heap& heap);
+        ~VM();
+        int global_slot(const std::string& name);
+        void interpret(std::unique_ptr<Ast> module) override;
+        std::string interpret_expression(std::unique_ptr<Ast> module) override;
+};
+
+#endif
@@ -0,0 +1,38 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#include <algorithm>
+#include <cstdint>
+
+#include "ast.hpp"
+
+// a chunk holds a few hundred nodes, a small script fits in one
+static const size_t CHUNK_SIZE = 1 << 15;
+
+Ast::~Ast()
+{
+    // children were made before their parents, tear down in reverse
+    for (auto destructor = destructors.rbegin(); destructor != destructors.rend(); destructor++)
+        destructor->destroy(destructor->node);
+}
+
+void* Ast::allocate(size_t size, size_t align)
+{
+    size_t padding = -reinterpret_cast<uintptr_t>(chunk) & (align - 1);
+
+    if (chunk_end - chunk < static_cast<ptrdiff_t>(padding + size))
+    {
+        // the rest of the old chunk is lost, it's smaller than one node
+        size_t chunk_size = std::max(CHUNK_SIZE, size);
+        chunks.emplace_back(new char[chunk_size]);
+        chunk = chunks.back().get();
+        chunk_end = chunk + chunk_size;
+        padding = 0;
+    }
+
+    void* memory = chunk + padding;
+    chunk += padding + size;
+    return memory;
+}
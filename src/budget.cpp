@@ -0,0 +1,49 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#include <algorithm>
+
+#include "budget.hpp"
+#include "error.hpp"
+
+void Budget::set_limit(uint64_t max_steps)
+{
+    limit = max_steps;
+    schedule();
+}
+
+void Budget::set_callback(uint64_t interval, std::function<bool(uint64_t)> callback)
+{
+    this->interval = interval;
+    this->callback = std::move(callback);
+    schedule();
+}
+
+void Budget::schedule()
+{
+    // the nearest of the limit and the next callback
+    next_check = UINT64_MAX;
+
+    if (limit != 0)
+        next_check = limit + 1;
+
+    if (interval != 0 && callback)
+        next_check = std::min(next_check, (steps / interval + 1) * interval);
+}
+
+void Budget::check()
+{
+    // errors of the budget don't come from a line of the source
+    if (limit != 0 && steps > limit)
+        throw RuntimeError(Token(TOKEN_EOF, 0), "Step limit exceeded, the program can take " + std::to_string(limit) + " steps");
+
+    if (interval != 0 && callback && steps % interval == 0)
+    {
+        if (!callback(steps))
+            throw RuntimeError(Token(TOKEN_EOF, 0), "Program cancelled after " + std::to_string(steps) + " steps");
+    }
+
+    schedule();
+}
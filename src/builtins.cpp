@@ -10,7 +10,7 @@ int NativeClock::arity()
     return 0;
 }
 
-std::any NativeClock::call(Interpreter& interpreter, std::vector<std::any> args)
+Value NativeClock::call(const Token& paren, std::vector<Value> args)
 {
     auto ticks = std::chrono::system_clock::now().time_since_epoch();
     return std::chrono::duration<double>{ticks}.count() / 100.0;
@@ -27,7 +27,7 @@ int NativeTime::arity()
     return 0;
 }
 
-std::any NativeTime::call(Interpreter& interpreter, std::vector<std::any> args)
+Value NativeTime::call(const Token& paren, std::vector<Value> args)
 {
     std::time_t current_time = std::time(nullptr);
     return std::string(std::ctime(&current_time));
@@ -44,10 +44,12 @@ int NativeInput::arity()
     return 1;
 }
 
-std::any NativeInput::call(Interpreter& interpreter, std::vector<std::any> args)
+Value NativeInput::call(const Token& paren, std::vector<Value> args)
 {
-    std::string prompt = std::any_cast<std::string>(args[0]);
-    std::cout << prompt;
+    if (!args[0].is_string())
+        throw RuntimeError(paren, "Argument of 'input' must be a string");
+
+    std::cout << args[0].as_string();
 
     std::string input;
     std::getline(std::cin, input);
@@ -70,13 +72,22 @@ std::string NativeInput::to_string()
 
 int NativeExit::arity()
 {
-    return param_count;
+    return 1;
+}
+
+bool NativeExit::accepts(int argc)
+{
+    // the exit code is optional
+    return argc <= 1;
 }
 
-std::any NativeExit::call(Interpreter& interpreter, std::vector<std::any> args)
+Value NativeExit::call(const Token& paren, std::vector<Value> args)
 {
+    if (args.size() > 0 && !args[0].is_number())
+        throw RuntimeError(paren, "Argument of 'exit' must be a number");
+
     if (args.size() > 0)
-        exit((int)std::any_cast<double>(args[0]));
+        exit((int)args[0].as_number());
     else
         exit(0);
 }
@@ -92,9 +103,12 @@ int NativeFloorDiv::arity()
     return 2;
 }
 
-std::any NativeFloorDiv::call(Interpreter& interpreter, std::vector<std::any> args)
+Value NativeFloorDiv::call(const Token& paren, std::vector<Value> args)
 {
-    double div_res = std::any_cast<double>(args[0]) / std::any_cast<double>(args[1]);
+    if (!args[0].is_number() || !args[1].is_number())
+        throw RuntimeError(paren, "Arguments of 'floordiv' must be numbers");
+
+    double div_res = args[0].as_number() / args[1].as_number();
     return floor(div_res);
 }
 
@@ -108,12 +122,28 @@ int NativeArrayLen::arity()
     return 1;
 }
 
-std::any NativeArrayLen::call(Interpreter& interpreter, std::vector<std::any> args)
+Value NativeArrayLen::call(const Token& paren, std::vector<Value> args)
 {
-    return (double)std::any_cast<std::shared_ptr<ListType>>(args[0])->get_length();
+    if (!args[0].is_list())
+        throw RuntimeError(paren, "Argument of 'len' must be a list");
+
+    return (double)args[0].as_object<ListType>()->get_length();
 }
 
 std::string NativeArrayLen::to_string()
 {
     return "<native len>";
 }
+
+
+std::vector<std::pair<std::string, NblNative*>> make_natives()
+{
+    return {
+        {"clock", new NativeClock()},
+        {"time", new NativeTime()},
+        {"input", new NativeInput()},
+        {"exit", new NativeExit()},
+        {"floordiv", new NativeFloorDiv()},
+        {"len", new NativeArrayLen()}
+    };
+}
@@ -0,0 +1,100 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#include <iomanip>
+#include <iostream>
+
+#include "cache.hpp"
+#include "instance.hpp"
+#include "class.hpp"
+
+CacheStats InlineCache::get_stats;
+CacheStats InlineCache::set_stats;
+CacheStats InlineCache::call_stats;
+
+InlineCache::InlineCache(CacheStats& stats)
+    : stats(&stats) {}
+
+CacheEntry* InlineCache::find(Shape* shape)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (entries[i].shape.get() == shape)
+        {
+            stats->hits++;
+            return &entries[i];
+        }
+    }
+
+    stats->misses++;
+    return nullptr;
+}
+
+CacheEntry& InlineCache::replace(Shape* shape)
+{
+    // sites that see more shapes than WAYS keep cycling through the entries
+    CacheEntry& entry = count < WAYS ? entries[count++] : entries[evict++ % WAYS];
+    entry.shape = shape;
+    entry.offset = -1;
+    entry.method = nullptr;
+    entry.next = nullptr;
+    return entry;
+}
+
+const CacheEntry& InlineCache::get(NblInstance* instance, std::string_view name)
+{
+    // fields hide methods, so a shape without the field always finds the same method
+    if (CacheEntry* entry = find(instance->shape.get()))
+        return *entry;
+
+    std::string key(name);
+    CacheEntry& entry = replace(instance->shape.get());
+    entry.offset = instance->shape->find(key);
+
+    if (entry.offset < 0)
+        entry.method = instance->klass->find_method(key);
+
+    return entry;
+}
+
+void InlineCache::set(NblInstance* instance, std::string_view name, Value value)
+{
+    CacheEntry* entry = find(instance->shape.get());
+
+    if (entry == nullptr)
+    {
+        std::string key(name);
+        Shape* shape = instance->shape.get();
+        entry = &replace(shape);
+        entry->offset = shape->find(key);
+
+        if (entry->offset < 0)
+        {
+            entry->offset = shape->size();
+            entry->next = shape->add(key);
+        }
+    }
+
+    if (entry->next != nullptr)
+        instance->add_field(entry->next, std::move(value));
+    else
+        instance->fields[entry->offset] = std::move(value);
+}
+
+void InlineCache::print_stats()
+{
+    auto print = [](const char* site, const CacheStats& stats)
+    {
+        uint64_t total = stats.hits + stats.misses;
+        double rate = total > 0 ? 100.0 * stats.hits / total : 0;
+        std::cerr << site << ": " << stats.hits << " hits, " << stats.misses << " misses ("
+                  << std::fixed << std::setprecision(1) << rate << "% hit)\n";
+    };
+
+    std::cerr << "inline caches\n";
+    print("  get", get_stats);
+    print("  set", set_stats);
+    print("  call", call_stats);
+}
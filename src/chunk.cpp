@@ -0,0 +1,24 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#include "chunk.hpp"
+
+void Chunk::write(uint8_t byte, int line)
+{
+    code.push_back(byte);
+    lines.push_back(line);
+}
+
+int Chunk::add_constant(Value value)
+{
+    constants.push_back(std::move(value));
+    return constants.size() - 1;
+}
+
+int Chunk::add_cache(CacheStats& stats)
+{
+    caches.emplace_back(stats);
+    return caches.size() - 1;
+}
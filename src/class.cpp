@@ -3,41 +3,83 @@
 // Licensed under Apache License v2.0
 //------------------------------------//
 
+#include <algorithm>
+
 #include "class.hpp"
+#include "heap.hpp"
 
-NblClass::NblClass(std::string name, std::shared_ptr<NblClass> superclass, std::map<std::string, std::shared_ptr<NblFunction>> methods)
-    : name(std::move(name)), superclass(std::move(superclass)), methods(std::move(methods)) {}
+// where a symbol is or would go in a table sorted by symbol
+template <class Table>
+static auto find_slot(Table& methods, Symbol symbol)
+{
+    return std::lower_bound(methods.begin(), methods.end(), symbol,
+        [](const auto& entry, Symbol symbol) { return entry.first < symbol; });
+}
 
-std::shared_ptr<NblFunction> NblClass::find_method(const std::string& name)
+NblClass::NblClass(std::string name, Ref<NblClass> superclass, std::map<std::string, Ref<NblCallable>> methods)
+    : name(std::move(name)), superclass(std::move(superclass))
 {
-    auto element = methods.find(name);
-    
-    if (element != methods.end())
-        return element->second;
+    // start from the superclass's table, it only holds the methods the classes declare
+    if (this->superclass != nullptr)
+    {
+        this->methods = this->superclass->methods;
+        init = this->superclass->init;
+        init_arity = this->superclass->init_arity;
+    }
 
-    if (superclass != nullptr)
-        return superclass->find_method(name);
+    for (auto& [method_name, method] : methods)
+        add_method(method_name, std::move(method));
 
-    return nullptr;
+    Heap::track(this);
 }
 
-int NblClass::arity()
+void NblClass::add_method(const std::string& name, Ref<NblCallable> method)
 {
-    std::shared_ptr<NblFunction> initializer = find_method("init");
-    
-    if (initializer == nullptr)
-        return 0;
+    // overrides take the slot of the inherited method
+    static const Symbol init_symbol = SymbolTable::intern("init");
+    Symbol symbol = SymbolTable::intern(name);
 
-    return initializer->arity();
+    if (symbol == init_symbol)
+    {
+        init = method.get();
+        init_arity = method->arity();
+    }
+
+    auto slot = find_slot(methods, symbol);
+
+    if (slot != methods.end() && slot->first == symbol)
+        slot->second = std::move(method);
+    else
+        methods.emplace(slot, symbol, std::move(method));
 }
 
-std::any NblClass::call(Interpreter& interpreter, std::vector<std::any> arguments)
+NblCallable* NblClass::find_method(const std::string& name)
 {
-    auto instance = std::make_shared<NblInstance>(shared_from_this());
-    std::shared_ptr<NblFunction> initializer = find_method("init");
+    return find_method(SymbolTable::find(name));
+}
 
-    if (initializer != nullptr)
-        initializer->bind(instance)->call(interpreter, std::move(arguments));
+NblCallable* NblClass::find_method(Symbol symbol)
+{
+    // a class has few methods, the caches in front of this make it a miss path
+    auto slot = find_slot(methods, symbol);
+
+    if (slot == methods.end() || slot->first != symbol)
+        return nullptr;
+
+    return slot->second.get();
+}
+
+int NblClass::arity()
+{
+    return init_arity;
+}
+
+Value NblClass::call(Interpreter& interpreter, std::vector<Value> arguments)
+{
+    Ref<NblInstance> instance = new NblInstance(this);
+
+    if (init != nullptr)
+        static_cast<NblFunction*>(init)->invoke(interpreter, instance, std::move(arguments));
 
     return instance;
 }
@@ -46,3 +88,18 @@ std::string NblClass::to_string()
 {
     return name;
 }
+
+void NblClass::trace(Tracer& tracer)
+{
+    tracer.visit(superclass);
+
+    for (const auto& [symbol, method] : methods)
+        tracer.visit(method);
+}
+
+void NblClass::clear()
+{
+    superclass = nullptr;
+    methods.clear();
+    init = nullptr;
+}
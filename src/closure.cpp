@@ -0,0 +1,84 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#include "closure.hpp"
+#include "heap.hpp"
+
+NblUpvalue::NblUpvalue(Value* location)
+    : location(location)
+{
+    Heap::track(this);
+}
+
+void NblUpvalue::trace(Tracer& tracer)
+{
+    // an open upvalue's variable belongs to the frame it points into
+    if (location == &closed)
+        tracer.visit(closed);
+}
+
+void NblUpvalue::clear()
+{
+    closed = nullptr;
+}
+
+NblClosure::NblClosure(Ref<NblPrototype> prototype)
+    : prototype(std::move(prototype))
+{
+    upvalues.resize(this->prototype->upvalue_count);
+    Heap::track(this);
+}
+
+int NblClosure::arity()
+{
+    return prototype->arity;
+}
+
+std::string NblClosure::to_string()
+{
+    // same spelling as the tree-walker's functions
+    return prototype->name != "" ? "<func " + prototype->name + ">" : "<func lambda>";
+}
+
+void NblClosure::trace(Tracer& tracer)
+{
+    for (const Ref<NblUpvalue>& upvalue : upvalues)
+        tracer.visit(upvalue);
+}
+
+void NblClosure::clear()
+{
+    // keeps the slots, the closure can't run anymore but can still be printed
+    for (Ref<NblUpvalue>& upvalue : upvalues)
+        upvalue = nullptr;
+}
+
+NblBoundMethod::NblBoundMethod(Value receiver, Ref<NblClosure> method)
+    : receiver(std::move(receiver)), method(std::move(method))
+{
+    Heap::track(this);
+}
+
+int NblBoundMethod::arity()
+{
+    return method->arity();
+}
+
+std::string NblBoundMethod::to_string()
+{
+    return method->to_string();
+}
+
+void NblBoundMethod::trace(Tracer& tracer)
+{
+    tracer.visit(receiver);
+    tracer.visit(method);
+}
+
+void NblBoundMethod::clear()
+{
+    // the method is kept, to_string still needs it
+    receiver = nullptr;
+}
@@ -0,0 +1,1041 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#include <cmath>
+#include <iostream>
+#include <optional>
+
+#include "closure_compiler.hpp"
+#include "closure_engine.hpp"
+#include "list.hpp"
+#include "budget.hpp"
+#include "depth.hpp"
+#include "util.hpp"
+
+NblCompiledFunction::NblCompiledFunction(std::string name, std::shared_ptr<FunctionCode> code, std::vector<Ref<NblUpvalue>> upvalues, bool is_initializer)
+    : name(std::move(name)), code(std::move(code)), upvalues(std::move(upvalues)), is_initializer(is_initializer)
+{
+    Heap::track(this);
+}
+
+Ref<NblCompiledFunction> NblCompiledFunction::bind(Ref<NblInstance> instance)
+{
+    // only a method used as a value needs to remember its receiver
+    Ref<NblCompiledFunction> bound = new NblCompiledFunction(name, code, upvalues, is_initializer);
+    bound->receiver = instance;
+    return bound;
+}
+
+int NblCompiledFunction::arity()
+{
+    return code->arity;
+}
+
+std::string NblCompiledFunction::to_string()
+{
+    // same spelling as the tree-walker's functions
+    return name != "" ? "<func " + name + ">" : "<func lambda>";
+}
+
+void NblCompiledFunction::trace(Tracer& tracer)
+{
+    for (const Ref<NblUpvalue>& upvalue : upvalues)
+        tracer.visit(upvalue);
+
+    tracer.visit(receiver);
+}
+
+void NblCompiledFunction::clear()
+{
+    upvalues.clear();
+    receiver = nullptr;
+}
+
+// run statements until one of them returns or breaks
+static Completion run_block(const std::vector<StmtCode>& statements, const EnvironmentPtr& env)
+{
+    for (const StmtCode& statement : statements)
+    {
+        Completion completion = statement(env);
+
+        if (completion != Completion::NORMAL)
+            return completion;
+    }
+
+    return Completion::NORMAL;
+}
+
+static std::vector<Value> evaluate_all(const std::vector<ExprCode>& expressions, const EnvironmentPtr& env)
+{
+    std::vector<Value> values;
+    values.reserve(expressions.size());
+
+    for (const ExprCode& expression : expressions)
+        values.push_back(expression(env));
+
+    return values;
+}
+
+// comparisons and '**' throw unless both operands are numbers
+template <class Op>
+static ExprCode numeric(ExprCode left, ExprCode right, Token op, Op apply)
+{
+    return [left, right, op, apply](const EnvironmentPtr& env) -> Value
+    {
+        Value a = left(env);
+        Value b = right(env);
+
+        if (!a.is_number() || !b.is_number())
+            throw RuntimeError{op, "Operands must be numbers"};
+
+        return apply(a.as_number(), b.as_number());
+    };
+}
+
+template <class Op>
+static ExprCode numeric_constant(ExprCode left, double constant, Token op, Op apply)
+{
+    return [left, constant, op, apply](const EnvironmentPtr& env) -> Value
+    {
+        Value a = left(env);
+
+        if (!a.is_number())
+            throw RuntimeError{op, "Operands must be numbers"};
+
+        return apply(a.as_number(), constant);
+    };
+}
+
+// '-', '*', '/' and '%' on anything but numbers give nil, like the tree-walker
+template <class Op>
+static ExprCode arithmetic(ExprCode left, ExprCode right, Op apply)
+{
+    return [left, right, apply](const EnvironmentPtr& env) -> Value
+    {
+        Value a = left(env);
+        Value b = right(env);
+
+        if (a.is_number() && b.is_number())
+            return apply(a.as_number(), b.as_number());
+
+        return nullptr;
+    };
+}
+
+template <class Op>
+static ExprCode arithmetic_constant(ExprCode left, double constant, Op apply)
+{
+    return [left, constant, apply](const EnvironmentPtr& env) -> Value
+    {
+        Value a = left(env);
+
+        if (a.is_number())
+            return apply(a.as_number(), constant);
+
+        return nullptr;
+    };
+}
+
+static Value add(const Value& a, const Value& b, const Token& op)
+{
+    if (a.is_number() && b.is_number())
+        return a.as_number() + b.as_number();
+
+    if (a.is_string() && b.is_string())
+        return a.as_string() + b.as_string();
+
+    if (a.is_string() && b.is_number())
+        return a.as_string() + int_or_double(b.as_number());
+
+    if (a.is_number() && b.is_string())
+        return int_or_double(a.as_number()) + b.as_string();
+
+    throw RuntimeError{op, "Operands must be 2 numbers, 2 strings, or 1 number and 1 string"};
+}
+
+ClosureCompiler::ClosureCompiler(ClosureEngine& engine)
+    : engine(engine) {}
+
+std::vector<StmtCode> ClosureCompiler::compile(const std::vector<Stmt*>& statements)
+{
+    return compile_block(statements);
+}
+
+ExprCode ClosureCompiler::compile_expression(Expr* expr)
+{
+    return compile(expr);
+}
+
+
+Value ClosureCompiler::visitAssignExpr(AssignExpr* expr)
+{
+    expr_code = store(expr->local, expr->name, compile(expr->value));
+    return {};
+}
+
+Value ClosureCompiler::visitBinaryExpr(BinaryExpr* expr)
+{
+    ExprCode left = compile(expr->left);
+    const Token& op = expr->op;
+
+    // a number literal on the right is baked into the node instead of evaluated
+    auto literal = dynamic_cast<LiteralExpr*>(expr->right);
+
+    if (literal != nullptr && literal->value.is_number())
+    {
+        double constant = literal->value.as_number();
+
+        switch (op.type)
+        {
+            case GREATER: expr_code = numeric_constant(left, constant, op, [](double a, double b) { return a > b; }); return {};
+            case GREATER_EQUAL: expr_code = numeric_constant(left, constant, op, [](double a, double b) { return a >= b; }); return {};
+            case LESS: expr_code = numeric_constant(left, constant, op, [](double a, double b) { return a < b; }); return {};
+            case LESS_EQUAL: expr_code = numeric_constant(left, constant, op, [](double a, double b) { return a <= b; }); return {};
+            case MINUS: case MINUS_EQUAL: expr_code = arithmetic_constant(left, constant, [](double a, double b) { return a - b; }); return {};
+            case STAR: case STAR_EQUAL: expr_code = arithmetic_constant(left, constant, [](double a, double b) { return a * b; }); return {};
+            case SLASH: case SLASH_EQUAL: expr_code = arithmetic_constant(left, constant, [](double a, double b) { return a / b; }); return {};
+            case PERCENT: expr_code = arithmetic_constant(left, constant, [](double a, double b) { return fmod(a, b); }); return {};
+
+            case PLUS: case PLUS_EQUAL:
+            {
+                Value right = literal->value;
+
+                expr_code = [left, right, op](const EnvironmentPtr& env) -> Value
+                {
+                    Value a = left(env);
+
+                    if (a.is_number())
+                        return a.as_number() + right.as_number();
+
+                    return add(a, right, op);
+                };
+                return {};
+            }
+
+            default: break;
+        }
+    }
+
+    ExprCode right = compile(expr->right);
+
+    switch (op.type)
+    {
+        // comparisors
+        case BANG_EQUAL:
+            expr_code = [left, right](const EnvironmentPtr& env) -> Value
+            {
+                Value a = left(env);
+                Value b = right(env);
+                return !is_equal(a, b);
+            };
+            break;
+        case EQUAL_EQUAL:
+            expr_code = [left, right](const EnvironmentPtr& env) -> Value
+            {
+                Value a = left(env);
+                Value b = right(env);
+                return is_equal(a, b);
+            };
+            break;
+        case GREATER: expr_code = numeric(left, right, op, [](double a, double b) { return a > b; }); break;
+        case GREATER_EQUAL: expr_code = numeric(left, right, op, [](double a, double b) { return a >= b; }); break;
+        case LESS: expr_code = numeric(left, right, op, [](double a, double b) { return a < b; }); break;
+        case LESS_EQUAL: expr_code = numeric(left, right, op, [](double a, double b) { return a <= b; }); break;
+        case STAR_STAR: expr_code = numeric(left, right, op, [](double a, double b) { return pow(a, b); }); break;
+
+        // arithmetics
+        case PLUS: case PLUS_EQUAL:
+            expr_code = [left, right, op](const EnvironmentPtr& env) -> Value
+            {
+                Value a = left(env);
+                Value b = right(env);
+                return add(a, b, op);
+            };
+            break;
+        case MINUS: case MINUS_EQUAL: expr_code = arithmetic(left, right, [](double a, double b) { return a - b; }); break;
+        case STAR: case STAR_EQUAL: expr_code = arithmetic(left, right, [](double a, double b) { return a * b; }); break;
+        case SLASH: case SLASH_EQUAL: expr_code = arithmetic(left, right, [](double a, double b) { return a / b; }); break;
+        case PERCENT: expr_code = arithmetic(left, right, [](double a, double b) { return fmod(a, b); }); break;
+
+        default: // the parser never builds these, evaluate to nil like the tree-walker
+            expr_code = [left, right](const EnvironmentPtr& env) -> Value
+            {
+                left(env);
+                right(env);
+                return nullptr;
+            };
+            break;
+    }
+
+    return {};
+}
+
+Value ClosureCompiler::visitGroupingExpr(GroupingExpr* expr)
+{
+    // parentheses only matter to the parser
+    expr_code = compile(expr->expression);
+    return {};
+}
+
+Value ClosureCompiler::visitLiteralExpr(LiteralExpr* expr)
+{
+    Value value = expr->value;
+    expr_code = [value](const EnvironmentPtr&) -> Value { return value; };
+    return {};
+}
+
+Value ClosureCompiler::visitUnaryExpr(UnaryExpr* expr)
+{
+    ExprCode right = compile(expr->right);
+    Token op = expr->op;
+
+    switch (op.type)
+    {
+        case BANG:
+            expr_code = [right](const EnvironmentPtr& env) -> Value { return !is_truthy(right(env)); };
+            break;
+
+        case MINUS:
+            expr_code = [right, op](const EnvironmentPtr& env) -> Value
+            {
+                Value value = right(env);
+
+                if (!value.is_number())
+                    throw RuntimeError{op, "Operand must be a number"};
+
+                return -value.as_number();
+            };
+            break;
+
+        default:
+            expr_code = [right](const EnvironmentPtr& env) -> Value
+            {
+                right(env);
+                return nullptr;
+            };
+            break;
+    }
+
+    return {};
+}
+
+Value ClosureCompiler::visitMutExpr(MutExpr* expr)
+{
+    expr_code = load(expr->local, expr->name);
+    return {};
+}
+
+Value ClosureCompiler::visitLogicalExpr(LogicalExpr* expr)
+{
+    ExprCode left = compile(expr->left);
+    ExprCode right = compile(expr->right);
+
+    if (expr->op.type == OR)
+    {
+        expr_code = [left, right](const EnvironmentPtr& env) -> Value
+        {
+            Value value = left(env);
+            return is_truthy(value) ? value : right(env);
+        };
+    }
+    else
+    {
+        expr_code = [left, right](const EnvironmentPtr& env) -> Value
+        {
+            Value value = left(env);
+            return !is_truthy(value) ? value : right(env);
+        };
+    }
+
+    return {};
+}
+
+Value ClosureCompiler::visitCallExpr(CallExpr* expr)
+{
+    if (expr->method != nullptr)
+    {
+        expr_code = invoke(expr);
+        return {};
+    }
+
+    ExprCode callee = compile(expr->callee);
+    std::vector<ExprCode> arguments;
+    arguments.reserve(expr->arguments.size());
+
+    for (Expr* argument : expr->arguments)
+        arguments.push_back(compile(argument));
+
+    ClosureEngine* engine = &this->engine;
+    Token paren = expr->paren;
+    int argc = arguments.size();
+    bool tail = expr->tail;
+
+    expr_code = [engine, callee, arguments, paren, argc, tail](const EnvironmentPtr& env) -> Value
+    {
+        Value function = callee(env);
+        CallDepth depth(paren);
+
+        // a function called with the right number of arguments gets them straight in its slots
+        if (function.is_compiled_function())
+        {
+            NblCompiledFunction* compiled = function.as_object<NblCompiledFunction>();
+
+            if (compiled->code->arity == argc)
+            {
+                if (tail)
+                    return engine->tail_call(compiled, compiled->receiver, evaluate_all(arguments, env));
+
+                Frame frame(engine->frames, nullptr, compiled->code->slot_count);
+                Value* slots = frame.get().slots;
+                int base = 0;
+
+                if (compiled->code->is_method)
+                    slots[base++] = compiled->receiver;
+
+                for (int i = 0; i < argc; i++)
+                    slots[base + i] = arguments[i](env);
+
+                return engine->call_function(compiled, frame);
+            }
+        }
+
+        return engine->call_value(function, evaluate_all(arguments, env), paren);
+    };
+
+    return {};
+}
+
+Value ClosureCompiler::visitFunctionExpr(FunctionExpr* expr)
+{
+    std::shared_ptr<FunctionCode> code = compile_function(expr, false);
+    ClosureEngine* engine = &this->engine;
+
+    expr_code = [engine, code](const EnvironmentPtr& env) -> Value
+    {
+        return engine->make_function("", code, env, false);
+    };
+
+    return {};
+}
+
+Value ClosureCompiler::visitGetExpr(GetExpr* expr)
+{
+    expr_code = property(expr, InlineCache::get_stats);
+    return {};
+}
+
+Value ClosureCompiler::visitSetExpr(SetExpr* expr)
+{
+    ExprCode object = compile(expr->object);
+    ExprCode value = compile(expr->value);
+    Token name = expr->name;
+    auto cache = std::make_shared<InlineCache>(InlineCache::set_stats);
+
+    expr_code = [object, value, name, cache](const EnvironmentPtr& env) -> Value
+    {
+        Value instance = object(env);
+
+        if (!instance.is_instance())
+            throw RuntimeError(name, "Only instances have fields");
+
+        Value result = value(env);
+        cache->set(instance.as_object<NblInstance>(), name.lexeme(), result);
+        return result;
+    };
+
+    return {};
+}
+
+Value ClosureCompiler::visitThisExpr(ThisExpr* expr)
+{
+    expr_code = load(expr->local, expr->keyword);
+    return {};
+}
+
+Value ClosureCompiler::visitSuperExpr(SuperExpr* expr)
+{
+    // 'super' is always a capture of the method, 'this' is one inside a nested function
+    ExprCode load_superclass = load(expr->local, expr->keyword);
+    ExprCode load_object = load(expr->receiver, expr->keyword);
+    Token method = expr->method;
+    Symbol symbol = SymbolTable::intern(std::string(method.lexeme()));
+
+    expr_code = [load_superclass, load_object, method, symbol](const EnvironmentPtr& env) -> Value
+    {
+        Value superclass = load_superclass(env);
+        Value object = load_object(env);
+        NblCallable* function = superclass.as_object<NblClass>()->find_method(symbol);
+
+        if (function == nullptr) // can't find method
+            throw RuntimeError(method, "Undefined property '" + std::string(method.lexeme()) + "'");
+
+        return static_cast<NblCompiledFunction*>(function)->bind(object.as_object<NblInstance>());
+    };
+
+    return {};
+}
+
+Value ClosureCompiler::visitListExpr(ListExpr* expr)
+{
+    std::vector<ExprCode> elements;
+
+    for (Expr* element : expr->elements)
+        elements.push_back(compile(element));
+
+    expr_code = [elements](const EnvironmentPtr& env) -> Value
+    {
+        Ref<ListType> list = new ListType();
+
+        for (const ExprCode& element : elements)
+            list->append(element(env));
+
+        return list;
+    };
+
+    return {};
+}
+
+Value ClosureCompiler::visitSubscriptExpr(SubscriptExpr* expr)
+{
+    ExprCode name = compile(expr->name);
+    ExprCode index = compile(expr->index);
+    ExprCode value = expr->value != nullptr ? compile(expr->value) : nullptr;
+    Token paren = expr->paren;
+
+    expr_code = [name, index, value, paren](const EnvironmentPtr& env) -> Value
+    {
+        Value list_value = name(env);
+        Value index_value = index(env);
+
+        if (!list_value.is_list())
+            throw RuntimeError(paren, "Only lists can be subscripted");
+
+        if (!index_value.is_number())
+            throw RuntimeError(paren, "Index should be of type int");
+
+        ListType* list = list_value.as_object<ListType>();
+        int casted_index = index_value.as_number();
+
+        if (value != nullptr)
+        {
+            Value result = value(env);
+
+            if (!list->set_element_at(casted_index, result))
+                throw RuntimeError(paren, "Index out of range");
+
+            return result;
+        }
+
+        if (casted_index >= list->get_length() || casted_index < 0)
+            return nullptr;
+
+        return list->get_element_at(casted_index);
+    };
+
+    return {};
+}
+
+
+Completion ClosureCompiler::visitBlockStmt(BlockStmt* stmt)
+{
+    int slot_count = stmt->slot_count;
+    bool materialized = slot_count > 0;
+    ClosureEngine* engine = &this->engine;
+
+    scopes.push_back(Scope{0, materialized});
+    std::vector<StmtCode> statements = compile_block(stmt->statements);
+    scopes.pop_back();
+
+    if (materialized)
+    {
+        stmt_code = [statements, slot_count, engine](const EnvironmentPtr& env)
+        {
+            Frame frame(engine->frames, env, slot_count);
+            return run_block(statements, frame.pointer());
+        };
+    }
+    else
+    {
+        stmt_code = [statements](const EnvironmentPtr& env)
+        {
+            return run_block(statements, env);
+        };
+    }
+
+    return {};
+}
+
+Completion ClosureCompiler::visitExpressionStmt(ExpressionStmt* stmt)
+{
+    ExprCode expression = compile(stmt->expression);
+
+    stmt_code = [expression](const EnvironmentPtr& env)
+    {
+        expression(env);
+        return Completion::NORMAL;
+    };
+
+    return {};
+}
+
+Completion ClosureCompiler::visitPrintStmt(PrintStmt* stmt)
+{
+    ExprCode expression = compile(stmt->expression);
+
+    stmt_code = [expression](const EnvironmentPtr& env)
+    {
+        std::cout << stringify(expression(env)) + "\n";
+        return Completion::NORMAL;
+    };
+
+    return {};
+}
+
+Completion ClosureCompiler::visitMutStmt(MutStmt* stmt)
+{
+    int slot = declare();
+    ExprCode initializer = stmt->initializer != nullptr ? compile(stmt->initializer) : nullptr;
+    stmt_code = define(stmt->name, slot, std::move(initializer));
+    return {};
+}
+
+Completion ClosureCompiler::visitIfStmt(IfStmt* stmt)
+{
+    ExprCode condition = compile(stmt->condition);
+    StmtCode then_branch = compile(stmt->then_branch);
+
+    if (stmt->else_branch == nullptr)
+    {
+        stmt_code = [condition, then_branch](const EnvironmentPtr& env)
+        {
+            if (is_truthy(condition(env)))
+                return then_branch(env);
+
+            return Completion::NORMAL;
+        };
+    }
+    else
+    {
+        StmtCode else_branch = compile(stmt->else_branch);
+
+        stmt_code = [condition, then_branch, else_branch](const EnvironmentPtr& env)
+        {
+            if (is_truthy(condition(env)))
+                return then_branch(env);
+
+            return else_branch(env);
+        };
+    }
+
+    return {};
+}
+
+Completion ClosureCompiler::visitWhileStmt(WhileStmt* stmt)
+{
+    ExprCode condition = compile(stmt->condition);
+    StmtCode body = compile(stmt->body);
+    Budget* budget = &engine.budget;
+
+    stmt_code = [condition, body, budget](const EnvironmentPtr& env)
+    {
+        while (is_truthy(condition(env)))
+        {
+            Completion completion = body(env);
+
+            if (completion == Completion::BREAK)
+                break;
+
+            if (completion == Completion::RETURN)
+                return completion;
+
+            // counted where the vm jumps back, after a body that didn't break out
+            budget->tick();
+        }
+
+        return Completion::NORMAL;
+    };
+
+    return {};
+}
+
+Completion ClosureCompiler::visitFunctionStmt(FunctionStmt* stmt)
+{
+    // declared before the body so the function can call itself
+    int slot = declare();
+    std::shared_ptr<FunctionCode> code = compile_function(stmt->fn, false);
+    std::string name = std::string(stmt->name.lexeme());
+    ClosureEngine* engine = &this->engine;
+
+    ExprCode function = [engine, code, name](const EnvironmentPtr& env) -> Value
+    {
+        return engine->make_function(name, code, env, false);
+    };
+
+    stmt_code = define(stmt->name, slot, std::move(function));
+    return {};
+}
+
+Completion ClosureCompiler::visitReturnStmt(ReturnStmt* stmt)
+{
+    ExprCode value = stmt->value != nullptr ? compile(stmt->value) : nullptr;
+    ClosureEngine* engine = &this->engine;
+
+    stmt_code = [engine, value](const EnvironmentPtr& env)
+    {
+        engine->return_value = value != nullptr ? value(env) : Value();
+        return Completion::RETURN;
+    };
+
+    return {};
+}
+
+Completion ClosureCompiler::visitBreakStmt(BreakStmt* stmt)
+{
+    stmt_code = [](const EnvironmentPtr&) { return Completion::BREAK; };
+    return {};
+}
+
+Completion ClosureCompiler::visitClassStmt(ClassStmt* stmt)
+{
+    int slot = declare();
+    ExprCode superclass = nullptr;
+    Token superclass_name = stmt->name;
+
+    if (stmt->superclass != nullptr)
+    {
+        superclass = compile(stmt->superclass);
+        superclass_name = stmt->superclass->name;
+        scopes.push_back(Scope{1, true}); // 'super'
+    }
+
+    std::vector<std::pair<std::string, std::shared_ptr<FunctionCode>>> methods;
+
+    for (FunctionStmt* method : stmt->methods)
+        methods.emplace_back(std::string(method->name.lexeme()), compile_function(method->fn, true));
+
+    if (superclass != nullptr)
+        scopes.pop_back();
+
+    std::string name = std::string(stmt->name.lexeme());
+    ClosureEngine* engine = &this->engine;
+
+    ExprCode klass = [engine, superclass, superclass_name, methods, name](const EnvironmentPtr& env) -> Value
+    {
+        Value superclass_value;
+
+        // methods capture 'super' from a scope of its own, closed once they are made
+        std::optional<Frame> super_scope;
+        EnvironmentPtr scope = env;
+
+        if (superclass != nullptr)
+        {
+            superclass_value = superclass(env);
+
+            if (!superclass_value.is_class())
+                throw RuntimeError(superclass_name, "Superclass must be a class");
+
+            super_scope.emplace(engine->frames, env, 1);
+            scope = super_scope->pointer();
+            scope->define(superclass_value);
+        }
+
+        std::map<std::string, Ref<NblCallable>> table;
+
+        for (const auto& [method_name, code] : methods)
+            table[method_name] = engine->make_function(name, code, scope, method_name == "init");
+
+        Ref<NblClass> superklass = nullptr;
+        if (superclass_value.is_class())
+            superklass = superclass_value.as_object<NblClass>();
+
+        return new NblClass(name, superklass, std::move(table));
+    };
+
+    stmt_code = define(stmt->name, slot, std::move(klass));
+    return {};
+}
+
+Completion ClosureCompiler::visitImportStmt(ImportStmt* stmt)
+{
+    // the imported file's top level is resolved as globals, so it runs like any other program
+    ClosureEngine* engine = &this->engine;
+    std::string path = stmt->target->value.as_string();
+
+    stmt_code = [engine, path](const EnvironmentPtr&)
+    {
+        run_file(path, *engine);
+        return Completion::NORMAL;
+    };
+
+    return {};
+}
+
+
+ExprCode ClosureCompiler::compile(Expr* expr)
+{
+    expr->accept(*this);
+    return std::move(expr_code);
+}
+
+StmtCode ClosureCompiler::compile(Stmt* stmt)
+{
+    stmt->accept(*this);
+    return std::move(stmt_code);
+}
+
+std::vector<StmtCode> ClosureCompiler::compile_block(const std::vector<Stmt*>& statements)
+{
+    std::vector<StmtCode> code;
+    code.reserve(statements.size());
+
+    for (Stmt* statement : statements)
+        code.push_back(compile(statement));
+
+    return code;
+}
+
+std::shared_ptr<FunctionCode> ClosureCompiler::compile_function(FunctionExpr* fn, bool is_method)
+{
+    // parameters take the first slots of the function's scope, after 'this' for methods
+    int arity = fn->parameters.size();
+
+    // captures of the scopes around the function are found by walking the environments that exist at runtime
+    std::vector<Capture> captures = fn->captures;
+
+    for (Capture& capture : captures)
+    {
+        if (capture.is_local)
+            capture.depth = hops(capture.depth);
+    }
+
+    scopes.push_back(Scope{arity + is_method, true});
+    std::vector<StmtCode> body = compile_block(fn->body);
+    scopes.pop_back();
+
+    return std::make_shared<FunctionCode>(FunctionCode{arity, fn->slot_count, is_method, std::move(captures), std::move(body)});
+}
+
+ExprCode ClosureCompiler::property(GetExpr* expr, CacheStats& stats)
+{
+    // the site's cache lives as long as the compiled node
+    ExprCode object = compile(expr->object);
+    Token name = expr->name;
+    auto cache = std::make_shared<InlineCache>(stats);
+
+    return [object, name, cache](const EnvironmentPtr& env) -> Value
+    {
+        Value value = object(env);
+
+        if (!value.is_instance())
+            throw RuntimeError(name, "Only instances have properties");
+
+        NblInstance* instance = value.as_object<NblInstance>();
+        const CacheEntry& entry = cache->get(instance, name.lexeme());
+
+        if (entry.offset >= 0)
+            return instance->field_at(entry.offset);
+
+        if (entry.method == nullptr)
+            throw RuntimeError(name, "Undefined property '" + std::string(name.lexeme()) + "'");
+
+        return static_cast<NblCompiledFunction*>(entry.method)->bind(instance);
+    };
+}
+
+ExprCode ClosureCompiler::invoke(CallExpr* expr)
+{
+    // a method call hands the receiver straight to the method, nothing gets bound
+    ExprCode object = compile(expr->method->object);
+    std::vector<ExprCode> arguments;
+    arguments.reserve(expr->arguments.size());
+
+    for (Expr* argument : expr->arguments)
+        arguments.push_back(compile(argument));
+
+    ClosureEngine* engine = &this->engine;
+    Token name = expr->method->name;
+    Token paren = expr->paren;
+    auto cache = std::make_shared<InlineCache>(InlineCache::call_stats);
+    int argc = arguments.size();
+    bool tail = expr->tail;
+
+    return [engine, object, name, cache, arguments, paren, argc, tail](const EnvironmentPtr& env) -> Value
+    {
+        Value receiver = object(env);
+
+        if (!receiver.is_instance())
+            throw RuntimeError(name, "Only instances have properties");
+
+        NblInstance* instance = receiver.as_object<NblInstance>();
+        const CacheEntry& entry = cache->get(instance, name.lexeme());
+        CallDepth depth(paren);
+
+        if (entry.offset >= 0)
+        {
+            Value function = instance->field_at(entry.offset);
+            return engine->call_value(function, evaluate_all(arguments, env), paren);
+        }
+
+        if (entry.method == nullptr)
+            throw RuntimeError(name, "Undefined property '" + std::string(name.lexeme()) + "'");
+
+        // the entry can change while the arguments run, keep the method
+        NblCompiledFunction* method = static_cast<NblCompiledFunction*>(entry.method);
+
+        if (method->code->arity != argc)
+        {
+            evaluate_all(arguments, env);
+            Error::check_arity(paren, method->code->arity, argc);
+        }
+
+        if (tail)
+            return engine->tail_call(method, receiver, evaluate_all(arguments, env));
+
+        Frame frame(engine->frames, nullptr, method->code->slot_count);
+        Value* slots = frame.get().slots;
+        slots[0] = receiver;
+
+        for (int i = 0; i < argc; i++)
+            slots[i + 1] = arguments[i](env);
+
+        return engine->call_function(method, frame);
+    };
+}
+
+int ClosureCompiler::hops(int depth)
+{
+    // environments to walk at runtime, scopes that never got one are skipped
+    int target = scopes.size() - 1 - depth;
+    int count = 0;
+
+    for (int i = scopes.size() - 1; i > target; i--)
+    {
+        if (scopes[i].materialized)
+            count++;
+    }
+
+    return count;
+}
+
+int ClosureCompiler::declare()
+{
+    // -1 for globals, otherwise the next slot of the innermost scope
+    if (scopes.empty())
+        return -1;
+
+    return scopes.back().count++;
+}
+
+ExprCode ClosureCompiler::load(const LocalSlot& local, const Token& name)
+{
+    if (local.is_global())
+    {
+        ClosureEngine::Global* cell = engine.global(std::string(name.lexeme()));
+
+        return [cell, name](const EnvironmentPtr&) -> Value
+        {
+            if (!cell->defined)
+                throw RuntimeError(name, "Undefined variable: '" + std::string(name.lexeme()) + "'");
+
+            return cell->value;
+        };
+    }
+
+    // variables of outer functions are reached through the running function's upvalues
+    if (local.capture >= 0)
+    {
+        ClosureEngine* engine = &this->engine;
+        int index = local.capture;
+
+        return [engine, index](const EnvironmentPtr&) -> Value { return *(*engine->upvalues)[index]->location; };
+    }
+
+    int distance = hops(local.depth);
+    int slot = local.slot;
+
+    switch (distance)
+    {
+        case 0:
+            return [slot](const EnvironmentPtr& env) -> Value { return env->slots[slot]; };
+        case 1:
+            return [slot](const EnvironmentPtr& env) -> Value { return env->enclosing->slots[slot]; };
+        default:
+            return [distance, slot](const EnvironmentPtr& env) -> Value { return env->ancestor(distance)->slots[slot]; };
+    }
+}
+
+ExprCode ClosureCompiler::store(const LocalSlot& local, const Token& name, ExprCode value)
+{
+    if (local.is_global())
+    {
+        ClosureEngine::Global* cell = engine.global(std::string(name.lexeme()));
+
+        return [cell, name, value](const EnvironmentPtr& env) -> Value
+        {
+            Value result = value(env);
+
+            if (!cell->defined)
+                throw RuntimeError(name, "Undefined variable: '" + std::string(name.lexeme()) + "'");
+
+            cell->value = result;
+            return result;
+        };
+    }
+
+    if (local.capture >= 0)
+    {
+        ClosureEngine* engine = &this->engine;
+        int index = local.capture;
+
+        return [engine, index, value](const EnvironmentPtr& env) -> Value
+        {
+            Value result = value(env);
+            *(*engine->upvalues)[index]->location = result;
+            return result;
+        };
+    }
+
+    int distance = hops(local.depth);
+    int slot = local.slot;
+
+    if (distance == 0)
+    {
+        return [slot, value](const EnvironmentPtr& env) -> Value
+        {
+            Value result = value(env);
+            env->slots[slot] = result;
+            return result;
+        };
+    }
+
+    return [distance, slot, value](const EnvironmentPtr& env) -> Value
+    {
+        Value result = value(env);
+        env->ancestor(distance)->slots[slot] = result;
+        return result;
+    };
+}
+
+StmtCode ClosureCompiler::define(const Token& name, int slot, ExprCode value)
+{
+    // globals are late bound by name, locals go straight into the slot the resolver gave them
+    if (slot < 0)
+    {
+        ClosureEngine::Global* cell = engine.global(std::string(name.lexeme()));
+
+        return [cell, value](const EnvironmentPtr& env)
+        {
+            cell->value = value != nullptr ? value(env) : Value();
+            cell->defined = true;
+            return Completion::NORMAL;
+        };
+    }
+
+    return [slot, value](const EnvironmentPtr& env)
+    {
+        env->slots[slot] = value != nullptr ? value(env) : Value();
+        return Completion::NORMAL;
+    };
+}
@@ -0,0 +1,214 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#include "closure_engine.hpp"
+#include "budget.hpp"
+#include "interpreter.hpp"
+
+ClosureEngine::ClosureEngine(Heap& heap)
+    : Engine(heap)
+{
+    // native functions
+    for (auto& [name, native] : make_natives())
+        define_native(name, native);
+
+    leave_heap();
+}
+
+ClosureEngine::~ClosureEngine()
+{
+    // the globals and frames go after this, their objects belong to this heap
+    enter_heap();
+}
+
+void ClosureEngine::interpret(std::unique_ptr<Ast> module)
+{
+    Heap::Use use(&heap);
+
+    try
+    {
+        // compile the whole program first, then run it at the top level
+        // the closures copy what they need from the tree, it goes away before the program runs
+        // compiling makes objects too, running out of memory there is reported like any runtime error
+        ClosureCompiler compiler(*this);
+        std::vector<StmtCode> program = compiler.compile(module->statements);
+        module.reset();
+
+        // a 'break' outside of any loop only ends its own top level statement
+        for (const StmtCode& statement : program)
+            statement(nullptr);
+    }
+    catch (const RuntimeError& error)
+    {
+        Error::runtime_error(error);
+    }
+}
+
+std::string ClosureEngine::interpret_expression(std::unique_ptr<Ast> module)
+{
+    Heap::Use use(&heap);
+
+    try
+    {
+        ClosureCompiler compiler(*this);
+        ExprCode code = compiler.compile_expression(module->expression);
+        module.reset();
+
+        return stringify(code(nullptr));
+    }
+    catch (const RuntimeError& error)
+    {
+        Error::runtime_error(error);
+        return "";
+    }
+}
+
+Value ClosureEngine::call_value(const Value& callee, std::vector<Value> arguments, const Token& paren)
+{
+    // generic call path, the compiled call node handles functions of the right arity itself
+    switch (callee.get_type())
+    {
+        case ValueType::COMPILED_FUNCTION:
+        {
+            NblCompiledFunction* compiled = callee.as_object<NblCompiledFunction>();
+            Error::check_arity(paren, compiled->code->arity, arguments.size());
+            return invoke(compiled, compiled->receiver, std::move(arguments));
+        }
+        case ValueType::CLASS:
+        {
+            NblClass* klass = callee.as_object<NblClass>();
+            Error::check_arity(paren, klass->arity(), arguments.size());
+
+            Value instance = new NblInstance(klass);
+            NblCallable* initializer = klass->initializer();
+
+            if (initializer != nullptr)
+                invoke(static_cast<NblCompiledFunction*>(initializer), instance, std::move(arguments));
+
+            return instance;
+        }
+        case ValueType::NATIVE:
+        {
+            NblNative* native = callee.as_object<NblNative>();
+
+            if (!native->accepts(arguments.size()))
+                Error::check_arity(paren, native->arity(), arguments.size());
+
+            return native->call(paren, std::move(arguments));
+        }
+        default:
+            throw RuntimeError(paren, "Can only call functions");
+    }
+}
+
+Value ClosureEngine::invoke(NblCompiledFunction* function, const Value& receiver, std::vector<Value> arguments)
+{
+    // the arity is already checked, methods take the receiver in slot 0
+    Frame frame(frames, nullptr, function->code->slot_count);
+    Value* slots = frame.get().slots;
+    int base = 0;
+
+    if (function->code->is_method)
+        slots[base++] = receiver;
+
+    for (Value& argument : arguments)
+        slots[base++] = std::move(argument);
+
+    return call_function(function, frame);
+}
+
+Value ClosureEngine::call_function(NblCompiledFunction* function, Frame& frame)
+{
+    // the frame already holds the arguments in the parameter slots
+    // a call in tail position takes over the frame and runs in this loop, the native stack stays flat
+    Value callee; // holds the function of the last tail call
+    Restore<std::vector<Ref<NblUpvalue>>*> captures(upvalues, nullptr); // the caller's, once the call is over
+
+    while (true)
+    {
+        Completion completion = Completion::NORMAL;
+        const EnvironmentPtr& environment = frame.pointer();
+        budget.tick();
+        upvalues = &function->upvalues;
+
+        for (const StmtCode& statement : function->code->body)
+        {
+            completion = statement(environment);
+
+            if (completion != Completion::NORMAL)
+                break;
+        }
+
+        // initializers always hand back 'this'
+        if (function->is_initializer)
+            return environment->slots[0];
+
+        if (completion != Completion::RETURN)
+            return nullptr;
+
+        if (tail_function.is_nil())
+            return take_return_value();
+
+        Value next = std::move(tail_function);
+        function = next.as_object<NblCompiledFunction>();
+        frame.reset(nullptr, function->code->slot_count);
+        Value* slots = frame.get().slots;
+        int base = 0;
+
+        if (function->code->is_method)
+            slots[base++] = std::move(tail_receiver);
+
+        for (Value& argument : tail_arguments)
+            slots[base++] = std::move(argument);
+
+        tail_receiver = nullptr;
+        tail_arguments.clear();
+        callee = std::move(next);
+    }
+}
+
+Value ClosureEngine::tail_call(NblCompiledFunction* function, const Value& receiver, std::vector<Value> arguments)
+{
+    // the arguments already ran in the caller's frame, the call waits until the caller's body has returned
+    tail_function = function;
+    tail_receiver = receiver;
+    tail_arguments = std::move(arguments);
+    return nullptr;
+}
+
+Value ClosureEngine::take_return_value()
+{
+    // hand over the value of the last RETURN completion
+    return std::move(return_value);
+}
+
+Ref<NblCompiledFunction> ClosureEngine::make_function(std::string name, std::shared_ptr<FunctionCode> code, const EnvironmentPtr& env, bool is_initializer)
+{
+    // a closure captures only the free variables of its function
+    std::vector<Ref<NblUpvalue>> captured;
+    captured.reserve(code->captures.size());
+
+    for (const Capture& capture : code->captures)
+    {
+        if (capture.is_local)
+            captured.push_back(env->ancestor(capture.depth)->capture(capture.slot));
+        else
+            captured.push_back((*upvalues)[capture.index]);
+    }
+
+    return new NblCompiledFunction(std::move(name), std::move(code), std::move(captured), is_initializer);
+}
+
+ClosureEngine::Global* ClosureEngine::global(const std::string& name)
+{
+    return &globals[name];
+}
+
+void ClosureEngine::define_native(const std::string& name, NblNative* native)
+{
+    Global* cell = global(name);
+    cell->value = native;
+    cell->defined = true;
+}
@@ -0,0 +1,860 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#include <algorithm>
+
+#include "compiler.hpp"
+#include "vm.hpp"
+
+// largest index a LONG prefixed operand holds
+static const int LONG_INDEX_MAX = (1 << 24) - 1;
+
+// how many values an instruction leaves on the stack, calls and LIST are adjusted by their operand
+static int stack_effect(OpCode op)
+{
+    switch (op)
+    {
+        case OpCode::CONSTANT: case OpCode::NIL: case OpCode::TRUE: case OpCode::FALSE:
+        case OpCode::GET_LOCAL: case OpCode::GET_UPVALUE: case OpCode::GET_GLOBAL:
+        case OpCode::CLOSURE: case OpCode::CLASS: case OpCode::LIST: case OpCode::IMPORT:
+        case OpCode::LOAD_METHOD:
+            return 1;
+
+        case OpCode::POP: case OpCode::DEFINE_GLOBAL: case OpCode::SET_PROPERTY: case OpCode::GET_SUPER:
+        case OpCode::EQUAL: case OpCode::NOT_EQUAL: case OpCode::GREATER: case OpCode::GREATER_EQUAL:
+        case OpCode::LESS: case OpCode::LESS_EQUAL: case OpCode::ADD: case OpCode::SUBTRACT:
+        case OpCode::MULTIPLY: case OpCode::DIVIDE: case OpCode::MODULO: case OpCode::POWER:
+        case OpCode::PRINT: case OpCode::POP_JUMP_IF_FALSE: case OpCode::CLOSE_UPVALUE:
+        case OpCode::RETURN: case OpCode::METHOD: case OpCode::GET_INDEX: case OpCode::CALL_METHOD:
+        case OpCode::TAIL_CALL_METHOD:
+            return -1;
+
+        case OpCode::SET_INDEX:
+            return -2;
+
+        default:
+            return 0;
+    }
+}
+
+Compiler::Compiler(VM& vm)
+    : vm(vm) {}
+
+Ref<NblPrototype> Compiler::compile(const std::vector<Stmt*>& statements)
+{
+    begin_function("", FunctionType::NONE);
+
+    for (Stmt* statement : statements)
+    {
+        // a 'break' outside of any loop skips the rest of its top level statement
+        begin_break_target();
+        compile(statement);
+        end_break_target();
+    }
+
+    emit_return();
+    return end_function().prototype;
+}
+
+Ref<NblPrototype> Compiler::compile_expression(Expr* expr)
+{
+    // the prompt prints the value of a lone expression, so return it
+    begin_function("", FunctionType::NONE);
+    compile(expr);
+    emit_op(OpCode::RETURN);
+    return end_function().prototype;
+}
+
+
+Value Compiler::visitAssignExpr(AssignExpr* expr)
+{
+    compile(expr->value);
+    emit_store(expr->local, expr->name);
+    return {};
+}
+
+Value Compiler::visitBinaryExpr(BinaryExpr* expr)
+{
+    compile(expr->left);
+    compile(expr->right);
+    line = expr->op.line;
+
+    switch (expr->op.type)
+    {
+        case BANG_EQUAL: emit_op(OpCode::NOT_EQUAL); break;
+        case EQUAL_EQUAL: emit_op(OpCode::EQUAL); break;
+        case GREATER: emit_op(OpCode::GREATER); break;
+        case GREATER_EQUAL: emit_op(OpCode::GREATER_EQUAL); break;
+        case LESS: emit_op(OpCode::LESS); break;
+        case LESS_EQUAL: emit_op(OpCode::LESS_EQUAL); break;
+        case STAR_STAR: emit_op(OpCode::POWER); break;
+        case PLUS: case PLUS_EQUAL: emit_op(OpCode::ADD); break;
+        case MINUS: case MINUS_EQUAL: emit_op(OpCode::SUBTRACT); break;
+        case STAR: case STAR_EQUAL: emit_op(OpCode::MULTIPLY); break;
+        case SLASH: case SLASH_EQUAL: emit_op(OpCode::DIVIDE); break;
+        case PERCENT: emit_op(OpCode::MODULO); break;
+
+        default: // the parser never builds these, evaluate to nil like the tree-walker
+            emit_op(OpCode::POP);
+            emit_op(OpCode::POP);
+            emit_op(OpCode::NIL);
+            break;
+    }
+
+    return {};
+}
+
+Value Compiler::visitGroupingExpr(GroupingExpr* expr)
+{
+    compile(expr->expression);
+    return {};
+}
+
+Value Compiler::visitLiteralExpr(LiteralExpr* expr)
+{
+    const Value& value = expr->value;
+
+    if (value.is_nil())
+    {
+        emit_op(OpCode::NIL);
+    }
+    else if (value.is_bool())
+    {
+        emit_op(value.as_bool() ? OpCode::TRUE : OpCode::FALSE);
+    }
+    else
+    {
+        emit_indexed(OpCode::CONSTANT, 2, make_constant(value));
+    }
+
+    return {};
+}
+
+Value Compiler::visitUnaryExpr(UnaryExpr* expr)
+{
+    compile(expr->right);
+    line = expr->op.line;
+
+    if (expr->op.type == BANG)
+        emit_op(OpCode::NOT);
+    else if (expr->op.type == MINUS)
+        emit_op(OpCode::NEGATE);
+
+    return {};
+}
+
+Value Compiler::visitMutExpr(MutExpr* expr)
+{
+    emit_load(expr->local, expr->name);
+    return {};
+}
+
+Value Compiler::visitLogicalExpr(LogicalExpr* expr)
+{
+    // the left operand is the result when it decides the outcome
+    compile(expr->left);
+    int end_jump = emit_jump(expr->op.type == OR ? OpCode::JUMP_IF_TRUE : OpCode::JUMP_IF_FALSE);
+
+    emit_op(OpCode::POP);
+    compile(expr->right);
+    patch_jump(end_jump);
+
+    return {};
+}
+
+Value Compiler::visitCallExpr(CallExpr* expr)
+{
+    // method calls look the method up before the arguments run and pass the receiver as slot 0
+    // they get their own cache, separate from plain property reads
+    if (expr->method != nullptr)
+    {
+        compile(expr->method->object);
+        line = expr->method->name.line;
+        int name = name_constant(std::string(expr->method->name.lexeme()));
+        emit_indexed(OpCode::LOAD_METHOD, 2, name, make_cache(InlineCache::call_stats));
+    }
+    else
+        compile(expr->callee);
+
+    for (Expr* argument : expr->arguments)
+        compile(argument);
+
+    line = expr->paren.line;
+    if (expr->tail)
+        emit_op(expr->method != nullptr ? OpCode::TAIL_CALL_METHOD : OpCode::TAIL_CALL);
+    else
+        emit_op(expr->method != nullptr ? OpCode::CALL_METHOD : OpCode::CALL);
+
+    emit_byte(expr->arguments.size());
+    adjust_stack(-static_cast<int>(expr->arguments.size()));
+
+    return {};
+}
+
+Value Compiler::visitFunctionExpr(FunctionExpr* expr)
+{
+    compile_function(expr, FunctionType::FUNCTION, "");
+    return {};
+}
+
+Value Compiler::visitGetExpr(GetExpr* expr)
+{
+    emit_get(expr, InlineCache::get_stats);
+    return {};
+}
+
+Value Compiler::visitSetExpr(SetExpr* expr)
+{
+    // a receiver that can't hold fields fails before the value has any side effects
+    compile(expr->object);
+    line = expr->name.line;
+    emit_op(OpCode::CHECK_INSTANCE);
+    compile(expr->value);
+    line = expr->name.line;
+    int name = name_constant(std::string(expr->name.lexeme()));
+    emit_indexed(OpCode::SET_PROPERTY, 2, name, make_cache(InlineCache::set_stats));
+    return {};
+}
+
+Value Compiler::visitThisExpr(ThisExpr* expr)
+{
+    emit_load(expr->local, expr->keyword);
+    return {};
+}
+
+Value Compiler::visitSuperExpr(SuperExpr* expr)
+{
+    // 'this' lives in the scope just inside the one holding 'super'
+    emit_load(LocalSlot{expr->local.depth - 1, 0}, expr->keyword);
+    emit_load(expr->local, expr->keyword);
+
+    line = expr->method.line;
+    emit_indexed(OpCode::GET_SUPER, 2, name_constant(std::string(expr->method.lexeme())));
+
+    return {};
+}
+
+Value Compiler::visitListExpr(ListExpr* expr)
+{
+    for (Expr* element : expr->elements)
+        compile(element);
+
+    emit_op(OpCode::LIST);
+    emit_byte(expr->elements.size());
+    adjust_stack(-static_cast<int>(expr->elements.size()));
+
+    return {};
+}
+
+Value Compiler::visitSubscriptExpr(SubscriptExpr* expr)
+{
+    compile(expr->name);
+    compile(expr->index);
+
+    if (expr->value != nullptr)
+    {
+        line = expr->paren.line;
+        emit_op(OpCode::CHECK_SUBSCRIPT);
+        compile(expr->value);
+        line = expr->paren.line;
+        emit_op(OpCode::SET_INDEX);
+    }
+    else
+    {
+        line = expr->paren.line;
+        emit_op(OpCode::GET_INDEX);
+    }
+
+    return {};
+}
+
+Completion Compiler::visitBlockStmt(BlockStmt* stmt)
+{
+    begin_scope();
+
+    for (Stmt* statement : stmt->statements)
+        compile(statement);
+
+    end_scope();
+    return {};
+}
+
+Completion Compiler::visitExpressionStmt(ExpressionStmt* stmt)
+{
+    compile(stmt->expression);
+    emit_op(OpCode::POP);
+    return {};
+}
+
+Completion Compiler::visitPrintStmt(PrintStmt* stmt)
+{
+    compile(stmt->expression);
+    emit_op(OpCode::PRINT);
+    return {};
+}
+
+Completion Compiler::visitMutStmt(MutStmt* stmt)
+{
+    // a local takes its slot before the initializer runs, closures in the initializer may capture it
+    bool is_global = scopes.empty();
+
+    if (!is_global)
+        declare_local(stmt->name);
+
+    if (stmt->initializer != nullptr)
+        compile(stmt->initializer);
+    else
+        emit_op(OpCode::NIL);
+
+    if (is_global)
+    {
+        line = stmt->name.line;
+        emit_indexed(OpCode::DEFINE_GLOBAL, 2, global(std::string(stmt->name.lexeme())));
+    }
+
+    return {};
+}
+
+Completion Compiler::visitIfStmt(IfStmt* stmt)
+{
+    compile(stmt->condition);
+    int else_jump = emit_jump(OpCode::POP_JUMP_IF_FALSE);
+
+    compile(stmt->then_branch);
+
+    if (stmt->else_branch != nullptr)
+    {
+        int end_jump = emit_jump(OpCode::JUMP);
+        patch_jump(else_jump);
+        compile(stmt->else_branch);
+        patch_jump(end_jump);
+    }
+    else
+    {
+        patch_jump(else_jump);
+    }
+
+    return {};
+}
+
+Completion Compiler::visitWhileStmt(WhileStmt* stmt)
+{
+    int loop_start = chunk().code.size();
+
+    compile(stmt->condition);
+    int exit_jump = emit_jump(OpCode::POP_JUMP_IF_FALSE);
+
+    begin_break_target();
+    compile(stmt->body);
+    emit_loop(loop_start);
+
+    patch_jump(exit_jump);
+    end_break_target();
+
+    return {};
+}
+
+Completion Compiler::visitFunctionStmt(FunctionStmt* stmt)
+{
+    // the name is declared first so the body can refer to itself
+    bool is_global = scopes.empty();
+
+    if (!is_global)
+        declare_local(stmt->name);
+
+    compile_function(stmt->fn, FunctionType::FUNCTION, std::string(stmt->name.lexeme()));
+
+    if (is_global)
+    {
+        line = stmt->name.line;
+        emit_indexed(OpCode::DEFINE_GLOBAL, 2, global(std::string(stmt->name.lexeme())));
+    }
+
+    return {};
+}
+
+Completion Compiler::visitReturnStmt(ReturnStmt* stmt)
+{
+    line = stmt->keyword.line;
+
+    if (stmt->value != nullptr)
+    {
+        compile(stmt->value);
+        emit_op(OpCode::RETURN);
+    }
+    else
+    {
+        emit_return();
+    }
+
+    return {};
+}
+
+Completion Compiler::visitBreakStmt(BreakStmt* stmt)
+{
+    // pop the locals of every scope the jump leaves, the code after the jump still sees them
+    BreakTarget& target = current().breaks.back();
+    int depth = current().stack_depth;
+
+    for (int i = scopes.size() - 1; i >= target.scope_depth; i--)
+        discard_locals(scopes[i]);
+
+    target.jumps.push_back(emit_jump(OpCode::JUMP));
+    current().stack_depth = depth;
+
+    return {};
+}
+
+Completion Compiler::visitClassStmt(ClassStmt* stmt)
+{
+    bool is_global = scopes.empty();
+    int slot = 0;
+
+    // a local class keeps the slot the resolver gave its name
+    if (!is_global)
+    {
+        emit_op(OpCode::NIL);
+        slot = declare_local(stmt->name);
+    }
+
+    if (stmt->superclass != nullptr)
+    {
+        // 'super' is a local of its own scope, methods capture it
+        begin_scope();
+        compile(stmt->superclass);
+        declare_local(stmt->superclass->name);
+        line = stmt->superclass->name.line;
+    }
+    else
+    {
+        line = stmt->name.line;
+    }
+
+    emit_indexed(OpCode::CLASS, 2, name_constant(std::string(stmt->name.lexeme())));
+    emit_byte(stmt->superclass != nullptr);
+
+    for (FunctionStmt* method : stmt->methods)
+    {
+        FunctionType type = method->name.lexeme() == "init" ? FunctionType::INITIALIZER : FunctionType::METHOD;
+
+        // methods are named after their class, same as the tree-walker
+        compile_function(method->fn, type, std::string(stmt->name.lexeme()));
+        line = method->name.line;
+        emit_indexed(OpCode::METHOD, 2, name_constant(std::string(method->name.lexeme())));
+    }
+
+    line = stmt->name.line;
+
+    if (is_global)
+    {
+        emit_indexed(OpCode::DEFINE_GLOBAL, 2, global(std::string(stmt->name.lexeme())));
+    }
+    else
+    {
+        emit_indexed(OpCode::SET_LOCAL, 1, slot);
+        emit_op(OpCode::POP);
+    }
+
+    if (stmt->superclass != nullptr)
+        end_scope();
+
+    return {};
+}
+
+Completion Compiler::visitImportStmt(ImportStmt* stmt)
+{
+    // the imported file runs as a function call, its top level defines globals
+    line = stmt->keyword.line;
+    emit_indexed(OpCode::IMPORT, 2, make_constant(stmt->target->value));
+    emit_op(OpCode::POP);
+    return {};
+}
+
+
+Compiler::FunctionState& Compiler::current()
+{
+    return functions.back();
+}
+
+Chunk& Compiler::chunk()
+{
+    return current().prototype->chunk;
+}
+
+void Compiler::compile(Stmt* stmt)
+{
+    stmt->accept(*this);
+}
+
+void Compiler::compile(Expr* expr)
+{
+    expr->accept(*this);
+}
+
+void Compiler::compile_function(FunctionExpr* fn, FunctionType type, const std::string& name)
+{
+    begin_function(name, type);
+    int function = functions.size() - 1;
+    current().prototype->arity = fn->parameters.size();
+
+    // methods hold 'this' in slot 0 of their own scope, the callee slot of plain functions is hidden
+    if (type == FunctionType::METHOD || type == FunctionType::INITIALIZER)
+        scopes.push_back(Scope{function, 0, 1});
+    else
+        scopes.push_back(Scope{function, 1, 0});
+
+    for (const Token& parameter : fn->parameters)
+        declare_local(parameter);
+
+    current().stack_depth = current().local_count;
+    adjust_stack(0);
+
+    // a 'break' outside of any loop ends the function
+    begin_break_target();
+
+    for (Stmt* statement : fn->body)
+        compile(statement);
+
+    end_break_target();
+    emit_return();
+
+    while (!scopes.empty() && scopes.back().function == function)
+        scopes.pop_back();
+
+    FunctionState state = end_function();
+
+    // the closure is built in the enclosing function
+    chunk().prototypes.push_back(state.prototype);
+    int prototype = chunk().prototypes.size() - 1;
+
+    // a LONG closure has u24 upvalue indices too
+    bool wide = prototype > UINT16_MAX
+        || std::any_of(state.upvalues.begin(), state.upvalues.end(), [](const Upvalue& upvalue) { return upvalue.index > UINT8_MAX; });
+
+    if (wide)
+    {
+        emit_op(OpCode::LONG);
+        emit_op(OpCode::CLOSURE);
+        emit_long(prototype);
+    }
+    else
+    {
+        emit_op(OpCode::CLOSURE);
+        emit_short(prototype);
+    }
+
+    for (const Upvalue& upvalue : state.upvalues)
+    {
+        emit_byte(upvalue.is_local ? 1 : 0);
+
+        if (wide)
+            emit_long(upvalue.index);
+        else
+            emit_byte(upvalue.index);
+    }
+}
+
+void Compiler::begin_function(const std::string& name, FunctionType type)
+{
+    FunctionState state;
+    state.prototype = new NblPrototype();
+    state.prototype->name = name;
+    state.prototype->max_stack = 1;
+    state.type = type;
+    state.captured.resize(1);
+    functions.push_back(std::move(state));
+}
+
+Compiler::FunctionState Compiler::end_function()
+{
+    FunctionState state = std::move(functions.back());
+    functions.pop_back();
+    state.prototype->upvalue_count = state.upvalues.size();
+    return state;
+}
+
+void Compiler::begin_scope()
+{
+    scopes.push_back(Scope{static_cast<int>(functions.size()) - 1, current().local_count, 0});
+}
+
+void Compiler::end_scope()
+{
+    discard_locals(scopes.back());
+    current().local_count -= scopes.back().count;
+    scopes.pop_back();
+}
+
+void Compiler::discard_locals(const Scope& scope)
+{
+    // captured locals move to the heap before they leave the stack
+    for (int i = scope.base + scope.count - 1; i >= scope.base; i--)
+        emit_op(current().captured[i] ? OpCode::CLOSE_UPVALUE : OpCode::POP);
+}
+
+int Compiler::declare_local(const Token& name)
+{
+    FunctionState& function = current();
+    int slot = function.local_count++;
+
+    if (slot > LONG_INDEX_MAX)
+        Error::error(name.line, "Too many local variables in function");
+
+    if (function.captured.size() < static_cast<size_t>(function.local_count))
+        function.captured.resize(function.local_count);
+
+    function.captured[slot] = false;
+    scopes.back().count++;
+
+    return slot;
+}
+
+void Compiler::begin_break_target()
+{
+    current().breaks.push_back(BreakTarget{static_cast<int>(scopes.size()), {}});
+}
+
+void Compiler::end_break_target()
+{
+    for (int jump : current().breaks.back().jumps)
+        patch_jump(jump);
+
+    current().breaks.pop_back();
+}
+
+void Compiler::emit_byte(uint8_t byte)
+{
+    chunk().write(byte, line);
+}
+
+void Compiler::emit_short(int value)
+{
+    emit_byte((value >> 8) & 0xff);
+    emit_byte(value & 0xff);
+}
+
+void Compiler::emit_long(int value)
+{
+    emit_byte((value >> 16) & 0xff);
+    emit_short(value & 0xffff);
+}
+
+void Compiler::emit_op(OpCode op)
+{
+    emit_byte(static_cast<uint8_t>(op));
+    adjust_stack(stack_effect(op));
+}
+
+void Compiler::emit_indexed(OpCode op, int width, int index, int second)
+{
+    // width is the short form in bytes, an index past it makes every index of the instruction u24
+    int limit = width == 1 ? UINT8_MAX : UINT16_MAX;
+    bool wide = index > limit || second > limit;
+
+    if (wide)
+        emit_op(OpCode::LONG);
+
+    emit_op(op);
+
+    for (int operand : {index, second})
+    {
+        if (operand < 0) // no second operand
+            continue;
+
+        if (wide)
+            emit_long(operand);
+        else if (width == 1)
+            emit_byte(operand);
+        else
+            emit_short(operand);
+    }
+}
+
+void Compiler::emit_return()
+{
+    // initializers always hand back the instance
+    if (current().type == FunctionType::INITIALIZER)
+    {
+        emit_indexed(OpCode::GET_LOCAL, 1, 0);
+    }
+    else
+    {
+        emit_op(OpCode::NIL);
+    }
+
+    emit_op(OpCode::RETURN);
+}
+
+int Compiler::emit_jump(OpCode op)
+{
+    emit_op(op);
+    emit_long(0xffffff);
+    return chunk().code.size() - 3;
+}
+
+void Compiler::patch_jump(int offset)
+{
+    int jump = chunk().code.size() - offset - 3;
+
+    if (jump > LONG_INDEX_MAX)
+        Error::error(line, "Too much code to jump over");
+
+    chunk().code[offset] = (jump >> 16) & 0xff;
+    chunk().code[offset + 1] = (jump >> 8) & 0xff;
+    chunk().code[offset + 2] = jump & 0xff;
+}
+
+void Compiler::emit_loop(int start)
+{
+    emit_op(OpCode::LOOP);
+    int offset = chunk().code.size() - start + 3;
+
+    if (offset > LONG_INDEX_MAX)
+        Error::error(line, "Loop body too large");
+
+    emit_long(offset);
+}
+
+void Compiler::emit_get(GetExpr* expr, CacheStats& stats)
+{
+    compile(expr->object);
+    line = expr->name.line;
+    int name = name_constant(std::string(expr->name.lexeme()));
+    emit_indexed(OpCode::GET_PROPERTY, 2, name, make_cache(stats));
+}
+
+void Compiler::adjust_stack(int effect)
+{
+    FunctionState& function = current();
+    function.stack_depth += effect;
+
+    if (function.stack_depth > function.prototype->max_stack)
+        function.prototype->max_stack = function.stack_depth;
+}
+
+int Compiler::make_constant(Value value)
+{
+    int index = chunk().add_constant(std::move(value));
+
+    if (index > LONG_INDEX_MAX)
+        Error::error(line, "Too many constants in one function");
+
+    return index;
+}
+
+int Compiler::make_cache(CacheStats& stats)
+{
+    int index = chunk().add_cache(stats);
+
+    if (index > LONG_INDEX_MAX)
+        Error::error(line, "Too many property accesses in one function");
+
+    return index;
+}
+
+int Compiler::name_constant(const std::string& name)
+{
+    // names repeat a lot, keep one constant per name
+    std::map<std::string, int>& names = current().names;
+    auto element = names.find(name);
+
+    if (element != names.end())
+        return element->second;
+
+    int index = make_constant(name);
+    names[name] = index;
+    return index;
+}
+
+int Compiler::global(const std::string& name)
+{
+    int slot = vm.global_slot(name);
+
+    if (slot > LONG_INDEX_MAX)
+        Error::error(line, "Too many global variables");
+
+    return slot;
+}
+
+int Compiler::resolve_upvalue(int function, int owner, int index)
+{
+    // thread the variable through every function between its owner and the one using it
+    bool is_local = owner == function - 1;
+
+    if (is_local)
+        functions[owner].captured[index] = true;
+    else
+        index = resolve_upvalue(function - 1, owner, index);
+
+    return add_upvalue(functions[function], index, is_local);
+}
+
+int Compiler::add_upvalue(FunctionState& function, int index, bool is_local)
+{
+    for (size_t i = 0; i < function.upvalues.size(); i++)
+    {
+        const Upvalue& upvalue = function.upvalues[i];
+
+        if (upvalue.index == index && upvalue.is_local == is_local)
+            return i;
+    }
+
+    if (function.upvalues.size() > LONG_INDEX_MAX)
+    {
+        Error::error(line, "Too many closure variables in function");
+        return 0;
+    }
+
+    function.upvalues.push_back(Upvalue{index, is_local});
+    return function.upvalues.size() - 1;
+}
+
+void Compiler::emit_load(const LocalSlot& local, const Token& name)
+{
+    line = name.line;
+
+    if (local.is_global())
+    {
+        emit_indexed(OpCode::GET_GLOBAL, 2, global(std::string(name.lexeme())));
+        return;
+    }
+
+    const Scope& scope = scopes[scopes.size() - 1 - local.depth];
+    int index = scope.base + local.slot;
+    int function = functions.size() - 1;
+
+    if (scope.function == function)
+    {
+        emit_indexed(OpCode::GET_LOCAL, 1, index);
+    }
+    else
+    {
+        emit_indexed(OpCode::GET_UPVALUE, 1, resolve_upvalue(function, scope.function, index));
+    }
+}
+
+void Compiler::emit_store(const LocalSlot& local, const Token& name)
+{
+    line = name.line;
+
+    if (local.is_global())
+    {
+        emit_indexed(OpCode::SET_GLOBAL, 2, global(std::string(name.lexeme())));
+        return;
+    }
+
+    const Scope& scope = scopes[scopes.size() - 1 - local.depth];
+    int index = scope.base + local.slot;
+    int function = functions.size() - 1;
+
+    if (scope.function == function)
+    {
+        emit_indexed(OpCode::SET_LOCAL, 1, index);
+    }
+    else
+    {
+        emit_indexed(OpCode::SET_UPVALUE, 1, resolve_upvalue(function, scope.function, index));
+    }
+}
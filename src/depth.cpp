@@ -0,0 +1,103 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#include <memory>
+#include <new>
+#include <sys/resource.h>
+#include <ucontext.h>
+
+#include "depth.hpp"
+
+// AddressSanitizer has to be told when the program switches stacks
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/common_interface_defs.h>
+#define START_SWITCH(fake_stack, bottom, size) __sanitizer_start_switch_fiber(fake_stack, bottom, size)
+#define FINISH_SWITCH(fake_stack, bottom, size) __sanitizer_finish_switch_fiber(fake_stack, bottom, size)
+#else
+#define START_SWITCH(fake_stack, bottom, size) ((void) (fake_stack), (void) (bottom), (void) (size))
+#define FINISH_SWITCH(fake_stack, bottom, size) ((void) (fake_stack), (void) (bottom), (void) (size))
+#endif
+
+size_t CallDepth::depth = 0;
+size_t CallDepth::max_depth = CallDepth::DEFAULT_LIMIT;
+const char* CallDepth::floor = nullptr;
+
+// stack left for whatever runs between two calls and for reporting the error
+static const size_t MARGIN = 256 << 10;
+
+// stack of everything besides the calls, what the main thread usually gets
+static const size_t BASE_STACK = 8 << 20;
+
+// the program switched to and the context it returns to
+static ucontext_t program_context;
+static ucontext_t caller_context;
+static const std::function<void()>* program;
+static size_t program_stack_size;
+static const void* caller_stack; // the caller's stack, for the sanitizer
+static size_t caller_stack_size;
+
+void CallDepth::set_limit(size_t depth)
+{
+    max_depth = depth;
+}
+
+void CallDepth::run(const std::function<void()>& body)
+{
+    // the stack is only reserved, the pages a program doesn't reach are never touched
+    // it's a context on this thread rather than a new thread, so the process stays single threaded
+    // (libstdc++ makes every shared_ptr count atomic once a second thread exists)
+    size_t stack_size = BASE_STACK + max_depth * FRAME_BYTES;
+    std::unique_ptr<char[]> stack{new (std::nothrow) char[stack_size]};
+
+    if (stack != nullptr && getcontext(&program_context) == 0)
+    {
+        program_context.uc_stack.ss_sp = stack.get();
+        program_context.uc_stack.ss_size = stack_size;
+        program_context.uc_link = &caller_context;
+        program = &body;
+        program_stack_size = stack_size;
+
+        makecontext(&program_context, start, 0);
+
+        void* fake_stack = nullptr;
+        START_SWITCH(&fake_stack, stack.get(), stack_size);
+
+        bool switched = swapcontext(&caller_context, &program_context) == 0;
+        FINISH_SWITCH(fake_stack, nullptr, nullptr);
+
+        if (switched)
+            return;
+    }
+
+    // no stack that big, run on this one and stop where it ends
+    rlimit limit;
+    stack_size = BASE_STACK;
+
+    if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+        stack_size = limit.rlim_cur;
+
+    run_on(stack_size, body);
+}
+
+void CallDepth::start()
+{
+    FINISH_SWITCH(nullptr, &caller_stack, &caller_stack_size);
+    run_on(program_stack_size, *program);
+    START_SWITCH(nullptr, caller_stack, caller_stack_size);
+}
+
+void CallDepth::run_on(size_t stack_size, const std::function<void()>& body)
+{
+    // stacks grow down from about here
+    floor = static_cast<const char*>(__builtin_frame_address(0)) - stack_size + MARGIN;
+    body();
+}
+
+void CallDepth::overflow(const Token& token)
+{
+    // the constructor throws, so the destructor won't undo the count
+    depth--;
+    throw RuntimeError(token, "Stack overflow");
+}
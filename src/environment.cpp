@@ -4,17 +4,27 @@
 //------------------------------------//
 
 #include "environment.hpp"
+#include "closure.hpp"
+#include "heap.hpp"
 
 Environment::Environment()
-    : enclosing(nullptr) {}
+    : enclosing(nullptr), slots(nullptr) {}
 
-Environment::Environment(std::shared_ptr<Environment> enclosing)
-    : enclosing(std::move(enclosing)) {}
+// only environments owning their slots can end up in a cycle, so only they are tracked
+Environment::Environment(Ref<Environment> enclosing, int size)
+    : enclosing(std::move(enclosing)), storage(size), slots(storage.data())
+{
+    Heap::track(this);
+}
 
+// borrows slots owned by someone else, the tree-walker's value stack
+Environment::Environment(Ref<Environment> enclosing, Value* slots)
+    : enclosing(std::move(enclosing)), slots(slots) {}
 
-std::any Environment::get(const Token& name)
+
+Value Environment::get(const Token& name)
 {
-    auto element = values.find(name.lexeme);
+    auto element = values.find(name.lexeme());
 
     // key found
     if (element != values.end())
@@ -24,12 +34,12 @@ std::any Environment::get(const Token& name)
     if (enclosing != nullptr)
         return enclosing->get(name);
 
-    throw RuntimeError(name, "Undefined variable: '" + name.lexeme + "'");
+    throw RuntimeError(name, "Undefined variable: '" + std::string(name.lexeme()) + "'");
 }
 
-void Environment::assign(const Token& name, std::any value)
+void Environment::assign(const Token& name, Value value)
 {
-    auto element = values.find(name.lexeme);
+    auto element = values.find(name.lexeme());
 
     if (element != values.end())
     {
@@ -43,30 +53,142 @@ void Environment::assign(const Token& name, std::any value)
         return;
     }
 
-    throw RuntimeError(name, "Undefined variable: '" + name.lexeme + "'");
+    throw RuntimeError(name, "Undefined variable: '" + std::string(name.lexeme()) + "'");
 }
 
-void Environment::define(const std::string& name, std::any value)
+void Environment::define(const std::string& name, Value value)
 {
     values[name] = std::move(value);
 }
 
-std::shared_ptr<Environment> Environment::ancestor(int distance)
+void Environment::define(Value value)
 {
-    std::shared_ptr<Environment> environment = shared_from_this();
+    // locals are defined in the same order the resolver numbered them
+    slots[defined++] = std::move(value);
+}
+
+Environment* Environment::ancestor(int distance)
+{
+    Environment* environment = this;
 
     for (int i = 0; i < distance; i++)
-        environment = environment->enclosing;
+        environment = environment->enclosing.get();
 
     return environment;
 }
 
-std::any Environment::get_at(int distance, const std::string& name)
+Value Environment::get_at(int distance, int slot)
+{
+    return ancestor(distance)->slots[slot];
+}
+
+void Environment::assign_at(int distance, int slot, Value value)
 {
-    return ancestor(distance)->values[name];
+    ancestor(distance)->slots[slot] = std::move(value);
+}
+
+Ref<NblUpvalue> Environment::capture(int slot)
+{
+    // closures capturing the same variable share one upvalue
+    Value* location = &slots[slot];
+
+    for (const Ref<NblUpvalue>& upvalue : upvalues)
+    {
+        if (upvalue->location == location)
+            return upvalue;
+    }
+
+    upvalues.push_back(new NblUpvalue(location));
+    return upvalues.back();
+}
+
+void Environment::close_upvalues()
+{
+    // the scope ends, captured variables move into their upvalues
+    for (const Ref<NblUpvalue>& upvalue : upvalues)
+    {
+        upvalue->closed = std::move(*upvalue->location);
+        upvalue->location = &upvalue->closed;
+    }
+
+    upvalues.clear();
+}
+
+void Environment::trace(Tracer& tracer)
+{
+    tracer.visit(enclosing);
+
+    for (const auto& [name, value] : values)
+        tracer.visit(value);
+
+    for (const Value& value : storage)
+        tracer.visit(value);
+
+    for (const Ref<NblUpvalue>& upvalue : upvalues)
+        tracer.visit(upvalue);
+}
+
+void Environment::clear()
+{
+    enclosing = nullptr;
+    values.clear();
+    upvalues.clear();
+
+    for (Value& value : storage)
+        value = nullptr;
+}
+
+Frame::Frame(FrameStack& stack, Ref<Environment> enclosing, int size)
+    : stack(stack)
+{
+    enter(std::move(enclosing), size);
+}
+
+Frame::~Frame()
+{
+    leave();
+}
+
+void Frame::enter(Ref<Environment> enclosing, int size)
+{
+    // a full stack falls back to the heap, deep recursion still runs
+    if (stack.values.get() + FrameStack::STACK_MAX - stack.top < size)
+    {
+        environment = new Environment(std::move(enclosing), size);
+        return;
+    }
+
+    base = stack.top;
+    stack.top += size;
+    local.emplace(std::move(enclosing), base);
+
+    // the frame holds one reference the whole time, so counting never deletes the stack environment
+    // no closure can keep it past the frame
+    local->retain();
+    environment = &*local;
+}
+
+void Frame::leave()
+{
+    if (!environment->upvalues.empty())
+        environment->close_upvalues();
+
+    if (base == nullptr)
+        return;
+
+    // let go of the values so the next frame finds its slots nil
+    for (Value* slot = base; slot != stack.top; slot++)
+        *slot = nullptr;
+
+    stack.top = base;
 }
 
-void Environment::assign_at(int distance, const Token& name, std::any value)
+void Frame::reset(Ref<Environment> enclosing, int size)
 {
-    ancestor(distance)->values[name.lexeme] = std::move(value);
+    // only the topmost frame can be reset, its slots are handed back first
+    leave();
+    environment = nullptr;
+    local.reset();
+    base = nullptr;
+    enter(std::move(enclosing), size);
 }
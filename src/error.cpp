@@ -27,7 +27,7 @@ void Error::error(const Token& token, std::string msg)
     if (token.type == TOKEN_EOF)
         report(token.line, " at end", msg);
     else
-        report(token.line, " at '" + token.lexeme + "'", msg);
+        report(token.line, " at '" + std::string(token.lexeme()) + "'", msg);
 }
 
 RuntimeError::RuntimeError(const Token& token, std::string msg)
@@ -35,7 +35,18 @@ RuntimeError::RuntimeError(const Token& token, std::string msg)
 
 void Error::runtime_error(const RuntimeError& error)
 {
-    // runtime error handling
-    std::cout << error.what() << "\nOn line " << error.token.line << "\n";
+    // runtime error handling, errors that don't come from the source (running out of memory) have no line
+    std::cout << error.what() << "\n";
+
+    if (error.token.line > 0)
+        std::cout << "On line " << error.token.line << "\n";
+
     has_runtime_error = true;
 }
+
+void Error::check_arity(const Token& paren, int arity, size_t argc)
+{
+    // throws when a call passes the wrong number of arguments
+    if (argc != static_cast<size_t>(arity))
+        throw RuntimeError(paren, "Expected " + std::to_string(arity) + " arguments but got " + std::to_string(argc));
+}
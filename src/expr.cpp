@@ -6,134 +6,137 @@
 #include "expr.hpp"
 
 
-AssignExpr::AssignExpr(Token name, std::shared_ptr<Expr> value)
-    : name(std::move(name)), value(std::move(value)) {}
+AssignExpr::AssignExpr(Token name, Expr* value)
+    : name(std::move(name)), value(value) {}
 
-std::any AssignExpr::accept(ExprVisitor& visitor)
+Value AssignExpr::accept(ExprVisitor& visitor)
 {
-    return visitor.visitAssignExpr(shared_from_this());
+    return visitor.visitAssignExpr(this);
 }
 
 
-BinaryExpr::BinaryExpr(std::shared_ptr<Expr> left, Token op, std::shared_ptr<Expr> right)
-    : left(std::move(left)), op(std::move(op)), right(std::move(right)) {}
+BinaryExpr::BinaryExpr(Expr* left, Token op, Expr* right)
+    : left(left), op(std::move(op)), right(right) {}
 
-std::any BinaryExpr::accept(ExprVisitor& visitor)
+Value BinaryExpr::accept(ExprVisitor& visitor)
 {
-    return visitor.visitBinaryExpr(shared_from_this());
+    return visitor.visitBinaryExpr(this);
 }
 
 
-GroupingExpr::GroupingExpr(std::shared_ptr<Expr> expression)
-    : expression(std::move(expression)) {}
+GroupingExpr::GroupingExpr(Expr* expression)
+    : expression(expression) {}
 
-std::any GroupingExpr::accept(ExprVisitor& visitor)
+Value GroupingExpr::accept(ExprVisitor& visitor)
 {
-    return visitor.visitGroupingExpr(shared_from_this());
+    return visitor.visitGroupingExpr(this);
 }
 
 
-LiteralExpr::LiteralExpr(std::any value)
+LiteralExpr::LiteralExpr(Value value)
     : value(std::move(value)) {}
 
-std::any LiteralExpr::accept(ExprVisitor& visitor)
+Value LiteralExpr::accept(ExprVisitor& visitor)
 {
-    return visitor.visitLiteralExpr(shared_from_this());
+    return visitor.visitLiteralExpr(this);
 }
 
 
-UnaryExpr::UnaryExpr(Token op, std::shared_ptr<Expr> right)
-    : op(std::move(op)), right(std::move(right)) {}
+UnaryExpr::UnaryExpr(Token op, Expr* right)
+    : op(std::move(op)), right(right) {}
 
-std::any UnaryExpr::accept(ExprVisitor& visitor)
+Value UnaryExpr::accept(ExprVisitor& visitor)
 {
-    return visitor.visitUnaryExpr(shared_from_this());
+    return visitor.visitUnaryExpr(this);
 }
 
 MutExpr::MutExpr(Token name)
     : name(std::move(name)) {}
 
-std::any MutExpr::accept(ExprVisitor& visitor)
+Value MutExpr::accept(ExprVisitor& visitor)
 {
-    return visitor.visitMutExpr(shared_from_this());
+    return visitor.visitMutExpr(this);
 }
 
 
-LogicalExpr::LogicalExpr(std::shared_ptr<Expr> left, Token op, std::shared_ptr<Expr> right)
-    : left(std::move(left)), op(std::move(op)), right(std::move(right)) {}
+LogicalExpr::LogicalExpr(Expr* left, Token op, Expr* right)
+    : left(left), op(std::move(op)), right(right) {}
 
-std::any LogicalExpr::accept(ExprVisitor& visitor)
+Value LogicalExpr::accept(ExprVisitor& visitor)
 {
-    return visitor.visitLogicalExpr(shared_from_this());
+    return visitor.visitLogicalExpr(this);
 }
 
-CallExpr::CallExpr(std::shared_ptr<Expr> callee, Token paren, std::vector<std::shared_ptr<Expr>> arguments)
-    : callee{std::move(callee)}, paren{std::move(paren)}, arguments{std::move(arguments)} {}
+CallExpr::CallExpr(Expr* callee, Token paren, std::vector<Expr*> arguments)
+    : callee{callee}, paren{std::move(paren)}, arguments{std::move(arguments)}
+{
+    method = dynamic_cast<GetExpr*>(this->callee);
+}
 
-std::any CallExpr::accept(ExprVisitor& visitor)
+Value CallExpr::accept(ExprVisitor& visitor)
 {
-    return visitor.visitCallExpr(shared_from_this());
+    return visitor.visitCallExpr(this);
 }
 
 
-FunctionExpr::FunctionExpr(std::vector<Token> parameters, std::vector<std::shared_ptr<Stmt>> body)
+FunctionExpr::FunctionExpr(std::vector<Token> parameters, std::vector<Stmt*> body)
     : parameters(std::move(parameters)), body(std::move(body)) {}
 
-std::any FunctionExpr::accept(ExprVisitor& visitor)
+Value FunctionExpr::accept(ExprVisitor& visitor)
 {
-    return visitor.visitFunctionExpr(shared_from_this());
+    return visitor.visitFunctionExpr(this);
 }
 
 
-GetExpr::GetExpr(std::shared_ptr<Expr> object, Token name)
-    : object(std::move(object)), name(std::move(name)) {}
+GetExpr::GetExpr(Expr* object, Token name)
+    : object(object), name(std::move(name)) {}
 
-std::any GetExpr::accept(ExprVisitor& visitor)
+Value GetExpr::accept(ExprVisitor& visitor)
 {
-    return visitor.visitGetExpr(shared_from_this());
+    return visitor.visitGetExpr(this);
 }
 
 
-SetExpr::SetExpr(std::shared_ptr<Expr> object, Token name, std::shared_ptr<Expr> value)
-    : object(std::move(object)), name(std::move(name)), value(std::move(value)) {}
+SetExpr::SetExpr(Expr* object, Token name, Expr* value)
+    : object(object), name(std::move(name)), value(value) {}
 
-std::any SetExpr::accept(ExprVisitor& visitor)
+Value SetExpr::accept(ExprVisitor& visitor)
 {
-    return visitor.visitSetExpr(shared_from_this());
+    return visitor.visitSetExpr(this);
 }
 
 
 ThisExpr::ThisExpr(Token keyword)
     : keyword(std::move(keyword)) {}
 
-std::any ThisExpr::accept(ExprVisitor& visitor)
+Value ThisExpr::accept(ExprVisitor& visitor)
 {
-    return visitor.visitThisExpr(shared_from_this());
+    return visitor.visitThisExpr(this);
 }
 
 
 SuperExpr::SuperExpr(Token keyword, Token method)
     : keyword(std::move(keyword)), method(std::move(method)) {}
 
-std::any SuperExpr::accept(ExprVisitor& visitor)
+Value SuperExpr::accept(ExprVisitor& visitor)
 {
-    return visitor.visitSuperExpr(shared_from_this());
+    return visitor.visitSuperExpr(this);
 }
 
 
-ListExpr::ListExpr(std::vector<std::shared_ptr<Expr>> elements)
+ListExpr::ListExpr(std::vector<Expr*> elements)
     : elements(std::move(elements)) {}
 
-std::any ListExpr::accept(ExprVisitor& visitor)
+Value ListExpr::accept(ExprVisitor& visitor)
 {
-    return visitor.visitListExpr(shared_from_this());
+    return visitor.visitListExpr(this);
 }
 
 
-SubscriptExpr::SubscriptExpr(std::shared_ptr<Expr> name, Token paren, std::shared_ptr<Expr> index, std::shared_ptr<Expr> value)
-    : name(std::move(name)), paren(std::move(paren)), index(std::move(index)), value(std::move(value)) {}
+SubscriptExpr::SubscriptExpr(Expr* name, Token paren, Expr* index, Expr* value)
+    : name(name), paren(std::move(paren)), index(index), value(value) {}
 
-std::any SubscriptExpr::accept(ExprVisitor& visitor)
+Value SubscriptExpr::accept(ExprVisitor& visitor)
 {
-    return visitor.visitSubscriptExpr(shared_from_this());
+    return visitor.visitSubscriptExpr(this);
 }
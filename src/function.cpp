@@ -6,17 +6,21 @@
 #include <iostream>
 
 #include "function.hpp"
+#include "budget.hpp"
 
-// get the name, declaration, closure and verify if it is an initializer
-NblFunction::NblFunction(std::string name, std::shared_ptr<FunctionExpr> declaration, std::shared_ptr<Environment> closure, bool is_initializer)
-    : name(name), declaration(declaration), closure(closure), is_initializer(is_initializer) {}
+// get the name, declaration, captured variables and the kind of function
+NblFunction::NblFunction(std::string name, FunctionExpr* declaration, std::vector<Ref<NblUpvalue>> upvalues, FunctionType type)
+    : name(std::move(name)), declaration(std::move(declaration)), upvalues(std::move(upvalues)), type(type)
+{
+    Heap::track(this);
+}
 
-std::shared_ptr<NblFunction> NblFunction::bind(std::shared_ptr<NblInstance> instance)
+Ref<NblFunction> NblFunction::bind(Ref<NblInstance> instance)
 {
-    // bind the function to a closure
-    auto environment = std::make_shared<Environment>(closure);
-    environment->define("this", instance);
-    return std::make_shared<NblFunction>(name, declaration, environment, is_initializer);
+    // only a method used as a value needs to remember its receiver
+    Ref<NblFunction> bound = new NblFunction(name, declaration, upvalues, type);
+    bound->receiver = instance;
+    return bound;
 }
 
 int NblFunction::arity()
@@ -25,32 +29,68 @@ int NblFunction::arity()
     return declaration->parameters.size();
 }
 
-std::any NblFunction::call(Interpreter& interpreter, std::vector<std::any> arguments)
+Value NblFunction::call(Interpreter& interpreter, std::vector<Value> arguments)
 {
-    // create a new environment at each function call
-    auto environment = std::make_shared<Environment>(closure);
+    return invoke(interpreter, receiver, std::move(arguments));
+}
+
+Value NblFunction::invoke(Interpreter& interpreter, const Value& receiver, std::vector<Value> arguments)
+{
+    // a new environment at each function call, on the value stack
+    // outer variables are reached through the upvalues, the body has no enclosing environment
+    Frame frame(interpreter.frames, nullptr, declaration->slot_count);
+    Environment& environment = frame.get();
+
+    // methods take 'this' as their first slot
+    if (type == FunctionType::METHOD || type == FunctionType::INITIALIZER)
+        environment.define(receiver);
 
     // add each parameter to the environment
-    for (int i = 0; i < declaration->parameters.size(); i++)
-        environment->define(declaration->parameters[i].lexeme, arguments[i]);
+    for (Value& argument : arguments)
+        environment.define(std::move(argument));
 
-    try
-    {
-        // execute the body
-        interpreter.execute_block(declaration->body, environment);
-    }
-    catch(NblReturn r) // catch return exception
+    return run(interpreter, frame);
+}
+
+Value NblFunction::run(Interpreter& interpreter, Frame& frame)
+{
+    // execute the body, the parameters are already defined
+    // a call in tail position takes over the frame and runs in this loop, the native stack stays flat
+    NblFunction* function = this;
+    Value callee; // holds the function of the last tail call
+    Restore<std::vector<Ref<NblUpvalue>>*> captures(interpreter.upvalues, nullptr); // the caller's, once the call is over
+
+    while (true)
     {
+        interpreter.budget.tick();
+        interpreter.upvalues = &function->upvalues;
+        Completion completion = interpreter.execute_block(function->declaration->body, frame.pointer());
+
         // for classes
-        if (is_initializer)
-            return closure->get_at(0, "this");
-        return r.value; // return the value
+        if (function->type == FunctionType::INITIALIZER)
+            return frame.get().get_at(0, 0);
+
+        if (completion != Completion::RETURN)
+            return nullptr;
+
+        if (interpreter.tail_function.is_nil())
+            return interpreter.take_return_value();
+
+        Value next = std::move(interpreter.tail_function);
+        Value receiver = std::move(interpreter.tail_receiver);
+        function = next.as_object<NblFunction>();
+        frame.reset(nullptr, function->declaration->slot_count);
+        Environment& environment = frame.get();
+
+        if (function->type == FunctionType::METHOD || function->type == FunctionType::INITIALIZER)
+            environment.define(std::move(receiver));
+
+        for (Value& argument : interpreter.tail_arguments)
+            environment.define(std::move(argument));
+
+        interpreter.tail_arguments.clear();
+        callee = std::move(next);
     }
-    
-    // no return exception
-    if (is_initializer)
-        return closure->get_at(0, "this");
-    return nullptr;
 }
 
 std::string NblFunction::to_string()
@@ -58,3 +98,17 @@ std::string NblFunction::to_string()
     // for printing the function itself (and the lambda functions)
     return name != "" ? "<func " + name + ">" : "<func lambda>";
 }
+
+void NblFunction::trace(Tracer& tracer)
+{
+    for (const Ref<NblUpvalue>& upvalue : upvalues)
+        tracer.visit(upvalue);
+
+    tracer.visit(receiver);
+}
+
+void NblFunction::clear()
+{
+    upvalues.clear();
+    receiver = nullptr;
+}
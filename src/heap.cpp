@@ -0,0 +1,328 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#include "heap.hpp"
+#include "error.hpp"
+
+Heap* Heap::active = nullptr;
+std::vector<Heap*> Heap::heaps;
+
+static const uint32_t REACHABLE = UINT32_MAX;
+
+// objects up to MAX_POOLED bytes come from chunks, rounded up to GRAIN bytes
+static const size_t GRAIN = 16;
+static const size_t MAX_POOLED = 256;
+static const size_t CHUNK_SIZE = 1 << 16;
+
+struct FreeBlock
+{
+    FreeBlock* next;
+};
+
+static FreeBlock* free_lists[MAX_POOLED / GRAIN + 1]; // freed memory, one list per size
+static char* chunk = nullptr; // unused rest of the newest chunk
+static char* chunk_end = nullptr;
+
+Object::Object()
+    : heap_id(Heap::current_id()) {}
+
+void* Object::operator new(size_t size)
+{
+    return Heap::allocate(size);
+}
+
+void Object::operator delete(Object* object, std::destroying_delete_t, size_t size)
+{
+    // freeing an object can free what it holds, the bytes all go back to the heap that paid for them
+    Heap::Use use(Heap::of(object));
+    object->~Object();
+    Heap::free(object, size);
+}
+
+void Object::operator delete(void* memory, size_t size)
+{
+    Heap::free(memory, size);
+}
+
+Object::~Object()
+{
+    if (heap_index != UNTRACKED)
+        Heap::untrack(this);
+}
+
+Heap::Heap()
+    : id(heaps.size())
+{
+    // ids aren't reused, an object never finds a newer heap under the id of its own
+    heaps.push_back(this);
+}
+
+Heap::~Heap()
+{
+    // objects still alive outlive their accounting
+    for (Object* object : objects)
+    {
+        object->heap_index = Object::UNTRACKED;
+        object->heap_id = NONE;
+    }
+
+    heaps[id] = nullptr;
+
+    if (active == this)
+        active = nullptr;
+}
+
+void* Heap::allocate(size_t size)
+{
+    if (size > MAX_POOLED)
+    {
+        charge_current(size);
+        return ::operator new(size);
+    }
+
+    size_t index = (size + GRAIN - 1) / GRAIN;
+    charge_current(index * GRAIN);
+    FreeBlock* block = free_lists[index];
+
+    if (block != nullptr)
+    {
+        free_lists[index] = block->next;
+        return block;
+    }
+
+    // nothing to recycle, cut the next piece off the chunk
+    size = index * GRAIN;
+
+    if (chunk_end - chunk < static_cast<ptrdiff_t>(size))
+    {
+        // the rest of the old chunk is lost, it's smaller than one object
+        // chunks live as long as the program, the free lists point into them
+        chunk = static_cast<char*>(::operator new(CHUNK_SIZE));
+        chunk_end = chunk + CHUNK_SIZE;
+    }
+
+    void* memory = chunk;
+    chunk += size;
+    return memory;
+}
+
+void Heap::free(void* memory, size_t size)
+{
+    if (size > MAX_POOLED)
+    {
+        refund_current(size);
+        ::operator delete(memory);
+        return;
+    }
+
+    size_t index = (size + GRAIN - 1) / GRAIN;
+    refund_current(index * GRAIN);
+    FreeBlock* block = static_cast<FreeBlock*>(memory);
+    block->next = free_lists[index];
+    free_lists[index] = block;
+}
+
+void Heap::set_threshold(size_t objects)
+{
+    threshold = objects;
+    next_major = objects;
+}
+
+void Heap::set_limit(size_t bytes)
+{
+    limit = bytes;
+    update_pressure();
+}
+
+void Heap::update_pressure()
+{
+    // collect again half way to the limit, but not more often than every sixteenth of it
+    size_t left = limit - std::min(limit, stats.bytes);
+    next_pressure = stats.bytes + std::max(left / 2, limit / 16);
+}
+
+void Heap::charge(size_t bytes)
+{
+    if (limit != 0 && stats.bytes + bytes > limit)
+        throw RuntimeError(Token(TOKEN_EOF, 0), "Out of memory, the heap is limited to " + std::to_string(limit) + " bytes");
+
+    stats.bytes += bytes;
+    stats.peak_bytes = std::max(stats.peak_bytes, stats.bytes);
+}
+
+void Heap::track(Object* object)
+{
+    // objects made while no engine ran aren't collected, counting still frees them
+    if (Heap* heap = of(object))
+        heap->add(object);
+}
+
+void Heap::untrack(Object* object)
+{
+    if (Heap* heap = of(object))
+        heap->remove(object);
+}
+
+void Heap::add(Object* object)
+{
+    // new objects join the young generation
+    object->heap_index = objects.size();
+    objects.push_back(object);
+    stats.peak = std::max<uint64_t>(stats.peak, objects.size());
+}
+
+void Heap::move(size_t from, size_t to)
+{
+    objects[to] = objects[from];
+    objects[to]->heap_index = to;
+}
+
+void Heap::remove(Object* object)
+{
+    size_t hole = object->heap_index;
+
+    // the last old object fills the hole, so the generations stay apart
+    if (hole < old_count)
+    {
+        old_count--;
+        move(old_count, hole);
+        hole = old_count;
+    }
+
+    // the last object takes the freed position
+    if (hole != objects.size() - 1)
+        move(objects.size() - 1, hole);
+
+    objects.pop_back();
+    object->heap_index = Object::UNTRACKED;
+}
+
+void Heap::collect()
+{
+    auto begin = std::chrono::steady_clock::now();
+
+    collect(old_count);
+    stats.minor++;
+
+    // the young survivors are old now, collect everything once the old generation has doubled
+    stats.promoted += objects.size() - old_count;
+    old_count = objects.size();
+
+    // or once the program gets close to the limit
+    if (old_count >= next_major || stats.bytes >= next_pressure)
+    {
+        collect(0);
+        stats.major++;
+        old_count = objects.size();
+        next_major = std::max(threshold, 2 * old_count);
+
+        if (limit != 0)
+            update_pressure();
+    }
+
+    stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+void Heap::collect(size_t start)
+{
+    // only objects from start on are collected, references from the others count as coming from outside
+    struct Subtract : Tracer
+    {
+        using Tracer::visit;
+        size_t start;
+
+        void visit(Object* object) override
+        {
+            if (object->heap_index != Object::UNTRACKED && object->heap_index >= start)
+                object->gc_refs--;
+        }
+    } subtract;
+
+    subtract.start = start;
+
+    for (size_t i = start; i < objects.size(); i++)
+        objects[i]->gc_refs = objects[i]->refcount;
+
+    for (size_t i = start; i < objects.size(); i++)
+        objects[i]->trace(subtract);
+
+    // whatever is left over is held from the outside, mark from there
+    struct Mark : Tracer
+    {
+        using Tracer::visit;
+        size_t start;
+        std::vector<Object*> pending;
+
+        void visit(Object* object) override
+        {
+            if (object->heap_index != Object::UNTRACKED && object->heap_index >= start && object->gc_refs != REACHABLE)
+            {
+                object->gc_refs = REACHABLE;
+                pending.push_back(object);
+            }
+        }
+    } mark;
+
+    mark.start = start;
+
+    for (size_t i = start; i < objects.size(); i++)
+    {
+        if (objects[i]->gc_refs > 0)
+            mark.visit(objects[i]);
+    }
+
+    while (!mark.pending.empty())
+    {
+        Object* object = mark.pending.back();
+        mark.pending.pop_back();
+        object->trace(mark);
+    }
+
+    std::vector<Object*> garbage;
+
+    for (size_t i = start; i < objects.size(); i++)
+    {
+        if (objects[i]->gc_refs != REACHABLE)
+            garbage.push_back(objects[i]);
+    }
+
+    // hold on to the garbage while its references are dropped, then let counting free it
+    for (Object* object : garbage)
+        object->retain();
+
+    for (Object* object : garbage)
+        object->clear();
+
+    for (Object* object : garbage)
+        object->release();
+
+    stats.freed += garbage.size();
+}
+
+void Heap::print_stats() const
+{
+    std::cerr << "garbage collector\n";
+    std::cerr << "  collections: " << stats.minor << " minor, " << stats.major << " major\n";
+    std::cerr << "  promoted: " << stats.promoted << " objects\n";
+    std::cerr << "  freed: " << stats.freed << " objects in cycles\n";
+    std::cerr << "  live: " << objects.size() << " objects, peak " << stats.peak << "\n";
+    std::cerr << "  time: " << std::fixed << std::setprecision(3) << stats.seconds * 1000 << " ms\n";
+    print_usage();
+}
+
+void Heap::print_usage() const
+{
+    std::cerr << "heap: peak " << stats.peak_bytes << " bytes";
+
+    if (limit != 0)
+        std::cerr << " of " << limit;
+
+    std::cerr << ", " << stats.bytes << " in use at exit\n";
+}
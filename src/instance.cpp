@@ -4,28 +4,83 @@
 //------------------------------------//
 
 #include "instance.hpp"
+#include "heap.hpp"
 
-NblInstance::NblInstance(std::shared_ptr<NblClass> klass)
-    : klass(std::move(klass)) {}
+NblInstance::NblInstance(Ref<NblClass> klass)
+    : klass(std::move(klass))
+{
+    shape = this->klass->root_shape;
+    fields.reserve(this->klass->field_count);
+    Heap::track(this);
+}
+
+void NblInstance::trace(Tracer& tracer)
+{
+    tracer.visit(klass);
+
+    for (const Value& field : fields)
+        tracer.visit(field);
+}
 
-std::any NblInstance::get(const Token& name)
+void NblInstance::clear()
 {
-    auto element = fields.find(name.lexeme);
+    // the shape stays, it still describes the (now nil) fields
+    klass = nullptr;
 
-    if (element != fields.end())
-        return element->second;
+    for (Value& field : fields)
+        field = nullptr;
+}
+
+Value* NblInstance::find_field(const std::string& name)
+{
+    int offset = shape->find(name);
+
+    if (offset < 0)
+        return nullptr;
+
+    return &fields[offset];
+}
+
+void NblInstance::set_field(const std::string& name, Value value)
+{
+    int offset = shape->find(name);
+
+    if (offset >= 0)
+    {
+        fields[offset] = std::move(value);
+        return;
+    }
+
+    add_field(shape->add(name), std::move(value));
+}
+
+void NblInstance::add_field(Shape* next, Value value)
+{
+    // a new field moves the instance to the next shape, its value goes at the end
+    // the value first, past the heap limit the push throws and the instance keeps its shape
+    fields.push_back(std::move(value));
+    shape = next;
+
+    if (shape->size() > klass->field_count)
+        klass->field_count = shape->size();
+}
+
+Value NblInstance::get(const Token& name)
+{
+    if (Value* field = find_field(std::string(name.lexeme())))
+        return *field;
 
-    std::shared_ptr<NblFunction> method = klass->find_method(name.lexeme);
+    NblCallable* method = klass->find_method(std::string(name.lexeme()));
 
     if (method != nullptr)
-        return method->bind(shared_from_this());
+        return static_cast<NblFunction*>(method)->bind(this);
 
-    throw RuntimeError(name, "Undefined property '" + name.lexeme + "'");
+    throw RuntimeError(name, "Undefined property '" + std::string(name.lexeme()) + "'");
 }
 
-void NblInstance::set(const Token& name, std::any value)
+void NblInstance::set(const Token& name, Value value)
 {
-    fields[name.lexeme] = std::move(value);
+    set_field(std::string(name.lexeme()), std::move(value));
 }
 
 std::string NblInstance::to_string()
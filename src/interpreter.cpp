@@ -4,38 +4,54 @@
 //------------------------------------//
 
 #include "interpreter.hpp"
+#include "budget.hpp"
+#include "depth.hpp"
 
-Interpreter::Interpreter()
+Interpreter::Interpreter(Heap& heap)
+    : Engine(heap)
 {
     // native functions
-    globals->define("clock", std::make_shared<NativeClock>());
-    globals->define("time", std::make_shared<NativeTime>());
-    globals->define("input", std::make_shared<NativeInput>());
-    globals->define("exit", std::make_shared<NativeExit>());
-    globals->define("floordiv", std::make_shared<NativeFloorDiv>());
-    globals->define("len", std::make_shared<NativeArrayLen>());
+    for (auto& [name, native] : make_natives())
+        globals->define(name, native);
+
+    leave_heap();
+}
+
+Interpreter::~Interpreter()
+{
+    // the globals and modules are released after this, into the heap that made them
+    enter_heap();
 }
 
-void Interpreter::interpret(const std::vector<std::shared_ptr<Stmt>>& statements)
+void Interpreter::interpret(std::unique_ptr<Ast> module)
 {
     // interpret function, statement version
+    Heap::Use use(&heap);
+    modules.push_back(std::move(module));
+    const std::vector<Stmt*>& statements = modules.back()->statements;
+
     try
     {
-        for (const std::shared_ptr<Stmt>& statement : statements)
+        for (Stmt* statement : statements)
             execute(statement);
     }
     catch (RuntimeError error)
     {
+        // the scopes it unwound through have put the environment back already
         Error::runtime_error(error);
     }
 }
 
-std::string Interpreter::interpret(const std::shared_ptr<Expr>& expr)
+std::string Interpreter::interpret_expression(std::unique_ptr<Ast> module)
 {
     // interpret function, expression version
+    Heap::Use use(&heap);
+    modules.push_back(std::move(module));
+    Expr* expr = modules.back()->expression;
+
     try
     {
-        std::any value = evaluate(expr);
+        Value value = evaluate(expr);
         return stringify(value);
     }
     catch(RuntimeError error)
@@ -45,163 +61,159 @@ std::string Interpreter::interpret(const std::shared_ptr<Expr>& expr)
     }
 }
 
-void Interpreter::resolve(std::shared_ptr<Expr> expr, int depth)
-{
-    // resolve local expression
-    locals[expr] = depth;
-}
-
-std::any Interpreter::visitBlockStmt(std::shared_ptr<BlockStmt> stmt)
+Completion Interpreter::visitBlockStmt(BlockStmt* stmt)
 {
     // block statement evaluation
-    execute_block(stmt->statements, std::make_shared<Environment>(environment));
-    return {};
+    Frame frame(frames, environment, stmt->slot_count);
+    return execute_block(stmt->statements, frame.pointer());
 }
 
-std::any Interpreter::visitExpressionStmt(std::shared_ptr<ExpressionStmt> stmt)
+Completion Interpreter::visitExpressionStmt(ExpressionStmt* stmt)
 {
     // expression statement evaluation
     evaluate(stmt->expression);
-    return {};
+    return Completion::NORMAL;
 }
 
-std::any Interpreter::visitPrintStmt(std::shared_ptr<PrintStmt> stmt)
+Completion Interpreter::visitPrintStmt(PrintStmt* stmt)
 {
     // print statement evaluation
-    std::any value = evaluate(stmt->expression);
+    Value value = evaluate(stmt->expression);
     std::cout << stringify(value) + "\n";
-    return {};
+    return Completion::NORMAL;
 }
 
-std::any Interpreter::visitMutStmt(std::shared_ptr<MutStmt> stmt)
+Completion Interpreter::visitMutStmt(MutStmt* stmt)
 {
     // mut statement evaluation
-    std::any value = nullptr;
+    Value value = nullptr;
 
     if (stmt->initializer != nullptr)
         value = evaluate(stmt->initializer);
 
-    environment->define(stmt->name.lexeme, std::move(value));
+    define(std::string(stmt->name.lexeme()), std::move(value));
     
-    return {};
+    return Completion::NORMAL;
 }
 
-std::any Interpreter::visitIfStmt(std::shared_ptr<IfStmt> stmt)
+Completion Interpreter::visitIfStmt(IfStmt* stmt)
 {
     // if statement evaluation
     if (is_truthy(evaluate(stmt->condition)))
-        execute(stmt->then_branch);
+        return execute(stmt->then_branch);
     else if (stmt->else_branch != nullptr)
-        execute(stmt->else_branch);
+        return execute(stmt->else_branch);
     
-    return {};
+    return Completion::NORMAL;
 }
 
-std::any Interpreter::visitWhileStmt(std::shared_ptr<WhileStmt> stmt)
+Completion Interpreter::visitWhileStmt(WhileStmt* stmt)
 {
     // while statement evaluation
-    try
-    {
-        while (is_truthy(evaluate(stmt->condition)))
-            execute(stmt->body);
-    }
-    catch (BreakException* bex)
+    while (is_truthy(evaluate(stmt->condition)))
     {
-        // pass
+        Completion completion = execute(stmt->body);
+
+        if (completion == Completion::BREAK)
+            break;
+
+        if (completion == Completion::RETURN)
+            return completion;
+
+        // counted where the vm jumps back, after a body that didn't break out
+        budget.tick();
     }
 
-    return {};
+    return Completion::NORMAL;
 }
 
-std::any Interpreter::visitFunctionStmt(std::shared_ptr<FunctionStmt> stmt)
+Completion Interpreter::visitFunctionStmt(FunctionStmt* stmt)
 {
     // function statement evaluation
-    std::string func_name = stmt->name.lexeme;
-    auto function = std::make_shared<NblFunction>(func_name, stmt->fn, environment, false);
-    environment->define(func_name, function);
-    return {};
+    std::string func_name(stmt->name.lexeme());
+    define(func_name, make_function(func_name, stmt->fn, FunctionType::FUNCTION));
+    return Completion::NORMAL;
 }
 
-std::any Interpreter::visitReturnStmt(std::shared_ptr<ReturnStmt> stmt)
+Completion Interpreter::visitReturnStmt(ReturnStmt* stmt)
 {
     // return statement evaluation
-    std::any value = nullptr;
+    Value value = nullptr;
 
     if (stmt->value != nullptr)
         value = evaluate(stmt->value);
 
-    throw NblReturn{value};
+    return_value = std::move(value);
+    return Completion::RETURN;
 }
 
-std::any Interpreter::visitBreakStmt(std::shared_ptr<BreakStmt> stmt)
+Completion Interpreter::visitBreakStmt(BreakStmt* stmt)
 {
     // break statement evaluation
-    throw new BreakException();
+    return Completion::BREAK;
 }
 
-std::any Interpreter::visitClassStmt(std::shared_ptr<ClassStmt> stmt)
+Completion Interpreter::visitClassStmt(ClassStmt* stmt)
 {
     // class statement evaluation
-    std::any superclass;
+    Value superclass;
     if (stmt->superclass != nullptr)
     {
         superclass = evaluate(stmt->superclass);
 
-        if (superclass.type() != typeid(std::shared_ptr<NblClass>))
+        if (!superclass.is_class())
             throw RuntimeError(stmt->superclass->name, "Superclass must be a class");
     }
 
-    environment->define(stmt->name.lexeme, nullptr);
+    // methods capture 'super' from a scope of its own, closed once they are made
+    std::optional<Frame> super_scope;
+    std::optional<Restore<Ref<Environment>>> in_super_scope;
 
     if (stmt->superclass != nullptr)
     {
-        environment = std::make_shared<Environment>(environment);
-        environment->define("super", superclass);
+        super_scope.emplace(frames, environment, 1);
+        in_super_scope.emplace(environment, super_scope->pointer());
+        environment->define(superclass);
     }
 
-    std::map<std::string, std::shared_ptr<NblFunction>> methods;
-    for (std::shared_ptr<FunctionStmt> method : stmt->methods)
+    std::map<std::string, Ref<NblCallable>> methods;
+    for (FunctionStmt* method : stmt->methods)
     {
-        bool is_method_init = method->name.lexeme == "init";
-        auto function = std::make_shared<NblFunction>(stmt->name.lexeme, method->fn, environment, is_method_init);
-        methods[method->name.lexeme] = function;
+        FunctionType type = method->name.lexeme() == "init" ? FunctionType::INITIALIZER : FunctionType::METHOD;
+        methods[std::string(method->name.lexeme())] = make_function(std::string(stmt->name.lexeme()), method->fn, type);
     }
 
-    std::shared_ptr<NblClass> superklass = nullptr;
-    if (superclass.type() == typeid(std::shared_ptr<NblClass>))
-        superklass = std::any_cast<std::shared_ptr<NblClass>>(superclass);
-
-    auto klass = std::make_shared<NblClass>(stmt->name.lexeme, superklass, methods);
+    Ref<NblClass> superklass = nullptr;
+    if (superclass.is_class())
+        superklass = superclass.as_object<NblClass>();
 
-    if (superklass != nullptr)
-        environment = environment->enclosing;
+    Ref<NblClass> klass = new NblClass(std::string(stmt->name.lexeme()), superklass, std::move(methods));
 
-    environment->assign(stmt->name, std::move(klass));
+    in_super_scope.reset(); // the class itself is defined outside
+    define(std::string(stmt->name.lexeme()), klass);
 
-    return {};
+    return Completion::NORMAL;
 }
 
-std::any Interpreter::visitImportStmt(std::shared_ptr<ImportStmt> stmt)
+Completion Interpreter::visitImportStmt(ImportStmt* stmt)
 {
     // import statement evaluation
-    std::string target = std::any_cast<std::string>(stmt->target->value);
-    run_file(target, *this);
-    return {};
+    // the imported file's top level is resolved as globals, so run it there
+    Restore<Ref<Environment>> scope(environment, globals);
+    run_file(stmt->target->value.as_string(), *this);
+    return Completion::NORMAL;
 }
 
 
-std::any Interpreter::visitAssignExpr(std::shared_ptr<AssignExpr> expr)
+Value Interpreter::visitAssignExpr(AssignExpr* expr)
 {
     // assign expression evaluation
-    std::any value = evaluate(expr->value);
+    Value value = evaluate(expr->value);
     // environment->assign(expr->name, value);
 
-    auto element = locals.find(expr);
-
-    if (element != locals.end())
+    if (!expr->local.is_global())
     {
-        int distance = element->second;
-        environment->assign_at(distance, expr->name, value);
+        local_at(expr->local) = value;
     }
     else
     {
@@ -211,11 +223,11 @@ std::any Interpreter::visitAssignExpr(std::shared_ptr<AssignExpr> expr)
     return value;
 }
 
-std::any Interpreter::visitBinaryExpr(std::shared_ptr<BinaryExpr> expr)
+Value Interpreter::visitBinaryExpr(BinaryExpr* expr)
 {
     // binary expression evaluation
-    std::any left = evaluate(expr->left);
-    std::any right = evaluate(expr->right);
+    Value left = evaluate(expr->left);
+    Value right = evaluate(expr->right);
 
     switch (expr->op.type)
     {
@@ -224,47 +236,47 @@ std::any Interpreter::visitBinaryExpr(std::shared_ptr<BinaryExpr> expr)
         case EQUAL_EQUAL: return is_equal(left, right);
         case GREATER:
             check_num_operands(expr->op, left, right);
-            return std::any_cast<double>(left) > std::any_cast<double>(right);
+            return left.as_number() > right.as_number();
         case GREATER_EQUAL:
             check_num_operands(expr->op, left, right);
-            return std::any_cast<double>(left) >= std::any_cast<double>(right);
+            return left.as_number() >= right.as_number();
         case LESS:
             check_num_operands(expr->op, left, right);
-            return std::any_cast<double>(left) < std::any_cast<double>(right);
+            return left.as_number() < right.as_number();
         case LESS_EQUAL:
             check_num_operands(expr->op, left, right);
-            return std::any_cast<double>(left) <= std::any_cast<double>(right);
+            return left.as_number() <= right.as_number();
         case STAR_STAR:
             check_num_operands(expr->op, left, right);
-            return pow(std::any_cast<double>(left), std::any_cast<double>(right));
+            return pow(left.as_number(), right.as_number());
 
         // arithmetics
         case PLUS: case PLUS_EQUAL:
-            if (left.type() == typeid(double) && right.type() == typeid(double))
-                return std::any_cast<double>(left) + std::any_cast<double>(right);
+            if (left.is_number() && right.is_number())
+                return left.as_number() + right.as_number();
 
-            if (left.type() == typeid(std::string) && right.type() == typeid(std::string))
-                return std::any_cast<std::string>(left) + std::any_cast<std::string>(right);
+            if (left.is_string() && right.is_string())
+                return left.as_string() + right.as_string();
 
-            if (left.type() == typeid(std::string) && right.type() == typeid(double))
-                return std::any_cast<std::string>(left) + int_or_double(right);
+            if (left.is_string() && right.is_number())
+                return left.as_string() + int_or_double(right.as_number());
 
-            if (left.type() == typeid(double) && right.type() == typeid(std::string))
-                return int_or_double(left) + std::any_cast<std::string>(right);
+            if (left.is_number() && right.is_string())
+                return int_or_double(left.as_number()) + right.as_string();
 
             throw RuntimeError{expr->op, "Operands must be 2 numbers, 2 strings, or 1 number and 1 string"};
         case MINUS: case MINUS_EQUAL:
-            if (left.type() == typeid(double) && right.type() == typeid(double))
-                return std::any_cast<double>(left) - std::any_cast<double>(right);
+            if (left.is_number() && right.is_number())
+                return left.as_number() - right.as_number();
         case STAR: case STAR_EQUAL:
-            if (left.type() == typeid(double) && right.type() == typeid(double))
-                return std::any_cast<double>(left) * std::any_cast<double>(right);
+            if (left.is_number() && right.is_number())
+                return left.as_number() * right.as_number();
         case SLASH: case SLASH_EQUAL:
-            if (left.type() == typeid(double) && right.type() == typeid(double))
-                return std::any_cast<double>(left) / std::any_cast<double>(right);
+            if (left.is_number() && right.is_number())
+                return left.as_number() / right.as_number();
         case PERCENT:
-            if (left.type() == typeid(double) && right.type() == typeid(double))
-                return fmod(std::any_cast<double>(left), std::any_cast<double>(right));
+            if (left.is_number() && right.is_number())
+                return fmod(left.as_number(), right.as_number());
     
         default: break;
     }
@@ -272,22 +284,22 @@ std::any Interpreter::visitBinaryExpr(std::shared_ptr<BinaryExpr> expr)
     return {}; // unreachable, here to make the compiler happy
 }
 
-std::any Interpreter::visitGroupingExpr(std::shared_ptr<GroupingExpr> expr)
+Value Interpreter::visitGroupingExpr(GroupingExpr* expr)
 {
     // parentheses evaluation
     return evaluate(expr->expression);
 }
 
-std::any Interpreter::visitLiteralExpr(std::shared_ptr<LiteralExpr> expr)
+Value Interpreter::visitLiteralExpr(LiteralExpr* expr)
 {
     // literal expresison evaluation
     return expr->value;
 }
 
-std::any Interpreter::visitUnaryExpr(std::shared_ptr<UnaryExpr> expr)
+Value Interpreter::visitUnaryExpr(UnaryExpr* expr)
 {
     // unary expression evaluation
-    std::any right = evaluate(expr->right);
+    Value right = evaluate(expr->right);
 
     switch (expr->op.type)
     {
@@ -296,7 +308,7 @@ std::any Interpreter::visitUnaryExpr(std::shared_ptr<UnaryExpr> expr)
 
         case MINUS:
             check_num_operand(expr->op, right);
-            return -std::any_cast<double>(right);
+            return -right.as_number();
         
         default:
             break;
@@ -305,16 +317,16 @@ std::any Interpreter::visitUnaryExpr(std::shared_ptr<UnaryExpr> expr)
     return {}; // unreachable, here to make the compiler happy
 }
 
-std::any Interpreter::visitMutExpr(std::shared_ptr<MutExpr> expr)
+Value Interpreter::visitMutExpr(MutExpr* expr)
 {
     // mutable expression evaluation
-    return lookup_mut(expr->name, expr);
+    return lookup_mut(expr->name, expr->local);
 }
 
-std::any Interpreter::visitLogicalExpr(std::shared_ptr<LogicalExpr> expr)
+Value Interpreter::visitLogicalExpr(LogicalExpr* expr)
 {
     // logical expression evaluation
-    std::any left = evaluate(expr->left);
+    Value left = evaluate(expr->left);
 
     if (expr->op.type == OR)
     {
@@ -330,141 +342,158 @@ std::any Interpreter::visitLogicalExpr(std::shared_ptr<LogicalExpr> expr)
     return evaluate(expr->right);
 }
 
-std::any Interpreter::visitCallExpr(std::shared_ptr<CallExpr> expr)
+Value Interpreter::visitCallExpr(CallExpr* expr)
 {
     // call expression evaluation
-    std::any callee = evaluate(expr->callee);
-    std::vector<std::any> arguments;
-
-    for (const std::shared_ptr<Expr>& argument : expr->arguments)
-        arguments.push_back(evaluate(argument));
-
-    // pointers in a std::any wrapper must be unwrapped before they can be cast
-    std::shared_ptr<NblCallable> function;
+    Value callee;
+    Value receiver;
+    NblFunction* method = nullptr;
 
-    if (callee.type() == typeid(std::shared_ptr<NblFunction>))
-    {
-        function = std::any_cast<std::shared_ptr<NblFunction>>(callee);
-    }
-    else if (callee.type() == typeid(std::shared_ptr<NblClass>))
+    if (expr->method != nullptr)
     {
-        function = std::any_cast<std::shared_ptr<NblClass>>(callee);
-    }
-    else if (callee.type() == typeid(std::shared_ptr<NativeClock>))
-    {
-        function = std::any_cast<std::shared_ptr<NativeClock>>(callee);
-    }
-    else if (callee.type() == typeid(std::shared_ptr<NativeTime>))
-    {
-        function = std::any_cast<std::shared_ptr<NativeTime>>(callee);
-    }
-    else if (callee.type() == typeid(std::shared_ptr<NativeInput>))
-    {
-        function = std::any_cast<std::shared_ptr<NativeInput>>(callee);
+        // a method call hands the receiver straight to the method, nothing gets bound
+        const CacheEntry& entry = lookup_property(expr->method, expr->cache, receiver);
+
+        if (entry.offset >= 0)
+            callee = receiver.as_object<NblInstance>()->field_at(entry.offset);
+        else
+            method = static_cast<NblFunction*>(entry.method);
     }
-    else if (callee.type() == typeid(std::shared_ptr<NativeExit>))
+    else
     {
-        std::shared_ptr<NativeExit> func = std::any_cast<std::shared_ptr<NativeExit>>(callee);
-        func->param_count = arguments.size() > 0 ? 1 : 0;
-        function = func;
+        callee = evaluate(expr->callee);
     }
-    else if (callee.type() == typeid(std::shared_ptr<NativeFloorDiv>))
+
+    if (method == nullptr && callee.is_function())
     {
-        function = std::any_cast<std::shared_ptr<NativeFloorDiv>>(callee);
+        method = callee.as_object<NblFunction>();
+        receiver = method->receiver;
     }
-    else if (callee.type() == typeid(std::shared_ptr<NativeArrayLen>))
+
+    // the native stack grows with every call, past the limit it's a stack overflow
+    CallDepth depth(expr->paren);
+
+    // the arguments of a function call go straight into its frame
+    if (method != nullptr && static_cast<size_t>(method->arity()) == expr->arguments.size())
     {
-        function = std::any_cast<std::shared_ptr<NativeArrayLen>>(callee);
+        if (expr->tail)
+            return tail_call(method, receiver, expr->arguments);
+
+        return call_function(method, receiver, expr->arguments);
     }
-    else
+
+    std::vector<Value> arguments;
+    arguments.reserve(expr->arguments.size());
+
+    for (Expr* argument : expr->arguments)
+        arguments.push_back(evaluate(argument));
+
+    // a function that gets here was passed the wrong number of arguments
+    if (method != nullptr)
+        Error::check_arity(expr->paren, method->arity(), arguments.size());
+
+    // one switch on the tag, then the callee's own call
+    switch (callee.get_type())
     {
-        throw RuntimeError(expr->paren, "Can only call functions");
-    }
+        case ValueType::CLASS:
+        {
+            NblClass* klass = callee.as_object<NblClass>();
+            Error::check_arity(expr->paren, klass->arity(), arguments.size());
+            return klass->call(*this, std::move(arguments));
+        }
+        case ValueType::NATIVE:
+        {
+            NblNative* native = callee.as_object<NblNative>();
 
-    if (arguments.size() != function->arity())
-        throw RuntimeError(expr->paren, "Expected " + std::to_string(function->arity()) + " arguments but got " + std::to_string(arguments.size()));
+            if (!native->accepts(arguments.size()))
+                Error::check_arity(expr->paren, native->arity(), arguments.size());
 
-    return function->call(*this, std::move(arguments));
+            return native->call(expr->paren, std::move(arguments));
+        }
+        default:
+            throw RuntimeError(expr->paren, "Can only call functions");
+    }
 }
 
-std::any Interpreter::visitFunctionExpr(std::shared_ptr<FunctionExpr> expr)
+Value Interpreter::visitFunctionExpr(FunctionExpr* expr)
 {
     // function expression evaluation
-    return std::make_shared<NblFunction>("", expr, environment, false);
+    return make_function("", expr, FunctionType::FUNCTION);
 }
 
-std::any Interpreter::visitGetExpr(std::shared_ptr<GetExpr> expr)
+Value Interpreter::visitGetExpr(GetExpr* expr)
 {
     // get expression evaluation
-    std::any object = evaluate(expr->object);
+    Value object;
+    const CacheEntry& entry = lookup_property(expr, expr->cache, object);
+    NblInstance* instance = object.as_object<NblInstance>();
 
-    if (object.type() == typeid(std::shared_ptr<NblInstance>))
-        return std::any_cast<std::shared_ptr<NblInstance>>(object)->get(expr->name);
+    if (entry.offset >= 0)
+        return instance->field_at(entry.offset);
 
-    throw RuntimeError(expr->name, "Only instances have properties");
+    return static_cast<NblFunction*>(entry.method)->bind(instance);
 }
 
-std::any Interpreter::visitSetExpr(std::shared_ptr<SetExpr> expr)
+Value Interpreter::visitSetExpr(SetExpr* expr)
 {
     // set expression evaluation
-    std::any object = evaluate(expr->object);
+    Value object = evaluate(expr->object);
 
-    if (object.type() != typeid(std::shared_ptr<NblInstance>))
+    if (!object.is_instance())
         throw RuntimeError(expr->name, "Only instances have fields");
 
-    std::any value = evaluate(expr->value);
-    std::any_cast<std::shared_ptr<NblInstance>>(object)->set(expr->name, value);
+    Value value = evaluate(expr->value);
+    expr->cache.set(object.as_object<NblInstance>(), expr->name.lexeme(), value);
 
     return value;
 }
 
-std::any Interpreter::visitThisExpr(std::shared_ptr<ThisExpr> expr)
+Value Interpreter::visitThisExpr(ThisExpr* expr)
 {
     // this expression evaluation
-    return lookup_mut(expr->keyword, expr);
+    return lookup_mut(expr->keyword, expr->local);
 }
 
-std::any Interpreter::visitSuperExpr(std::shared_ptr<SuperExpr> expr)
+Value Interpreter::visitSuperExpr(SuperExpr* expr)
 {
     // super expression evaluation
-    int distance = locals[expr];
-    auto superclass = std::any_cast<std::shared_ptr<NblClass>>(environment->get_at(distance, "super"));
-    auto obj = std::any_cast<std::shared_ptr<NblInstance>>(environment->get_at(distance - 1, "this"));
-    std::shared_ptr<NblFunction> method = superclass->find_method(expr->method.lexeme);
+    Value superclass = local_at(expr->local);
+    Value obj = local_at(expr->receiver);
+    NblCallable* method = superclass.as_object<NblClass>()->find_method(std::string(expr->method.lexeme()));
 
     if (method == nullptr) // can't find method
-        throw RuntimeError(expr->method, "Undefined property '" + expr->method.lexeme + "'");
+        throw RuntimeError(expr->method, "Undefined property '" + std::string(expr->method.lexeme()) + "'");
 
-    return method->bind(obj);
+    return static_cast<NblFunction*>(method)->bind(obj.as_object<NblInstance>());
 }
 
-std::any Interpreter::visitListExpr(std::shared_ptr<ListExpr> expr)
+Value Interpreter::visitListExpr(ListExpr* expr)
 {
     // list expression evaluation
-    auto list = std::make_shared<ListType>();
+    Ref<ListType> list = new ListType();
 
-    for (std::shared_ptr<Expr>& value : expr->elements)
+    for (Expr*& value : expr->elements)
         list->append(evaluate(value));
 
     return list;
 }
 
-std::any Interpreter::visitSubscriptExpr(std::shared_ptr<SubscriptExpr> expr)
+Value Interpreter::visitSubscriptExpr(SubscriptExpr* expr)
 {
     // subscript expression evaluation
-    std::any name = evaluate(expr->name);
-    std::any index = evaluate(expr->index);
+    Value name = evaluate(expr->name);
+    Value index = evaluate(expr->index);
 
-    if (name.type() == typeid(std::shared_ptr<ListType>))
+    if (name.is_list())
     {
-        if (index.type() == typeid(double))
+        if (index.is_number())
         {
-            std::shared_ptr<ListType> list = std::any_cast<std::shared_ptr<ListType>>(name);
-            int casted_index = std::any_cast<double>(index);
+            ListType* list = name.as_object<ListType>();
+            int casted_index = index.as_number();
 
             if (expr->value != nullptr)
             {
-                std::any value = evaluate(expr->value);
+                Value value = evaluate(expr->value);
 
                 if (list->set_element_at(casted_index, value))
                     return value;
@@ -493,15 +522,12 @@ std::any Interpreter::visitSubscriptExpr(std::shared_ptr<SubscriptExpr> expr)
 }
 
 
-std::any Interpreter::lookup_mut(const Token& name, std::shared_ptr<Expr> expr)
+Value Interpreter::lookup_mut(const Token& name, const LocalSlot& local)
 {
     // find variable in local or global environment
-    auto element = locals.find(expr);
-
-    if (element != locals.end())
+    if (!local.is_global())
     {
-        int distance = element->second;
-        return environment->get_at(distance, name.lexeme);
+        return local_at(local);
     }
     else
     {
@@ -509,173 +535,138 @@ std::any Interpreter::lookup_mut(const Token& name, std::shared_ptr<Expr> expr)
     }
 }
 
-std::any Interpreter::evaluate(std::shared_ptr<Expr> expr)
+Value& Interpreter::local_at(const LocalSlot& local)
 {
-    // send expression back into interpreter's visitor methods for evaluation
-    return expr->accept(*this);
-}
+    // variables of outer functions are reached through the running function's upvalues
+    if (local.capture >= 0)
+        return *(*upvalues)[local.capture]->location;
 
-void Interpreter::execute(std::shared_ptr<Stmt> stmt)
-{
-    // send statement back into interpreter's visitor methods for evaluation
-    stmt->accept(*this);
+    return environment->ancestor(local.depth)->slots[local.slot];
 }
 
-void Interpreter::execute_block(const std::vector<std::shared_ptr<Stmt>>& statements, std::shared_ptr<Environment> environment)
+Ref<NblFunction> Interpreter::make_function(std::string name, FunctionExpr* fn, FunctionType type)
 {
-    // execute a given block of statements
-    std::shared_ptr<Environment> previous_env = this->environment;
-
-    try
-    {
-        this->environment = environment;
+    // a closure captures only the free variables of its function
+    std::vector<Ref<NblUpvalue>> captured;
+    captured.reserve(fn->captures.size());
 
-        for (const std::shared_ptr<Stmt>& statement : statements)
-            execute(statement);
-    }
-    catch (...)
+    for (const Capture& capture : fn->captures)
     {
-        this->environment = previous_env;
-        throw;
+        if (capture.is_local)
+            captured.push_back(environment->ancestor(capture.depth)->capture(capture.slot));
+        else
+            captured.push_back((*upvalues)[capture.index]);
     }
 
-    this->environment = previous_env;
+    return new NblFunction(std::move(name), std::move(fn), std::move(captured), type);
 }
 
-void Interpreter::check_num_operand(const Token& op, const std::any& operand)
+void Interpreter::define(const std::string& name, Value value)
 {
-    // check if operand is a number
-    if (operand.type() == typeid(double))
-        return;
-    
-    throw RuntimeError{op, "Operand must be a number"};
+    // globals are late bound by name, locals take the next slot of their scope
+    if (environment == globals)
+        globals->define(name, std::move(value));
+    else
+        environment->define(std::move(value));
 }
 
-void Interpreter::check_num_operands(const Token& op, const std::any& left, const std::any& right)
+const CacheEntry& Interpreter::lookup_property(GetExpr* expr, InlineCache& cache, Value& object)
 {
-    // check if operands are numbers
-    if (left.type() == typeid(double) && right.type() == typeid(double))
-        return;
-    
-    throw RuntimeError{op, "Operands must be numbers"};
-}
+    // find what a property name means on an instance, the cache skips the lookup for shapes it has seen
+    object = evaluate(expr->object);
 
-bool Interpreter::is_truthy(const std::any& obj)
-{
-    // handle boolean values
-    if (obj.type() == typeid(nullptr))
-        return false;
-    
-    if (obj.type() == typeid(bool))
-        return std::any_cast<bool>(obj);
-    
-    return true;
-}
+    if (!object.is_instance())
+        throw RuntimeError(expr->name, "Only instances have properties");
 
-bool Interpreter::is_equal(const std::any& obj1, const std::any& obj2)
-{
-    // handle equality
-    if (obj1.type() == typeid(nullptr) && obj2.type() == typeid(nullptr))
-        return true;
+    const CacheEntry& entry = cache.get(object.as_object<NblInstance>(), expr->name.lexeme());
 
-    if (obj1.type() == typeid(nullptr))
-        return false;
+    if (entry.offset < 0 && entry.method == nullptr)
+        throw RuntimeError(expr->name, "Undefined property '" + std::string(expr->name.lexeme()) + "'");
 
-    if (obj1.type() == typeid(std::string) && obj2.type() == typeid(std::string))
-        return std::any_cast<std::string>(obj1) == std::any_cast<std::string>(obj2);
+    return entry;
+}
 
-    if (obj1.type() == typeid(double) && obj2.type() == typeid(double))
-        return std::any_cast<double>(obj1) == std::any_cast<double>(obj2);
+Value Interpreter::evaluate(Expr* expr)
+{
+    // send expression back into interpreter's visitor methods for evaluation
+    return expr->accept(*this);
+}
 
-    if (obj1.type() == typeid(bool) && obj2.type() == typeid(bool))
-        return std::any_cast<bool>(obj1) == std::any_cast<bool>(obj2);
+Value Interpreter::take_return_value()
+{
+    // hand over the value of the last RETURN completion
+    return std::move(return_value);
+}
 
-    return false;
+Completion Interpreter::execute(Stmt* stmt)
+{
+    // send statement back into interpreter's visitor methods for evaluation
+    return stmt->accept(*this);
 }
 
-std::string Interpreter::int_or_double(const std::any& obj)
+Completion Interpreter::execute_block(const std::vector<Stmt*>& statements, Ref<Environment> environment)
 {
-    // checking for weather the object is an int or a double
-    std::string text;
+    // execute a given block of statements
+    // stops early and hands the completion up when a 'return' or 'break' runs
+    Restore<Ref<Environment>> scope(this->environment, std::move(environment));
+    Completion completion = Completion::NORMAL;
 
-    if (std::any_cast<double>(obj) == static_cast<int>(std::any_cast<double>(obj)))
+    for (Stmt* statement : statements)
     {
-        // is an integer
-        text = std::to_string(static_cast<int>(std::any_cast<double>(obj)));
-    }
-    else
-    {
-        // is a double
-        text = std::to_string(std::any_cast<double>(obj));
+        completion = execute(statement);
 
-        if (text[text.length() - 2] == '.' && text[text.length() - 1] == '0')
-            text = text.substr(0, text.length() - 2);
+        if (completion != Completion::NORMAL)
+            break;
     }
 
-    return text;
+    return completion;
 }
 
-std::string Interpreter::stringify(const std::any& obj)
+Value Interpreter::call_function(NblFunction* function, const Value& receiver, const std::vector<Expr*>& arguments)
 {
-    // stringifying each types
-    if (obj.type() == typeid(nullptr))
-        return "nil";
-
-    if (obj.type() == typeid(double))
-        return int_or_double(obj);
-
-    if (obj.type() == typeid(std::string))
-        return std::any_cast<std::string>(obj);
-
-    if (obj.type() == typeid(bool))
-        return std::any_cast<bool>(obj) ? "true" : "false";
-    
-    if (obj.type() == typeid(std::shared_ptr<NblFunction>))
-        return std::any_cast<std::shared_ptr<NblFunction>>(obj)->to_string();
+    // the arity is already checked, the arguments are evaluated into the new frame
+    FunctionExpr* declaration = function->declaration;
+    Frame frame(frames, nullptr, declaration->slot_count);
+    Environment& callee = frame.get();
 
-    if (obj.type() == typeid(std::shared_ptr<NblClass>))
-        return std::any_cast<std::shared_ptr<NblClass>>(obj)->to_string();
+    if (function->type == FunctionType::METHOD || function->type == FunctionType::INITIALIZER)
+        callee.define(receiver);
 
-    if (obj.type() == typeid(std::shared_ptr<NblInstance>))
-        return std::any_cast<std::shared_ptr<NblInstance>>(obj)->to_string();
-    
-    if (obj.type() == typeid(std::shared_ptr<NativeClock>))
-        return std::any_cast<std::shared_ptr<NativeClock>>(obj)->to_string();
-
-    if (obj.type() == typeid(std::shared_ptr<NativeTime>))
-        return std::any_cast<std::shared_ptr<NativeTime>>(obj)->to_string();
-    
-    if (obj.type() == typeid(std::shared_ptr<NativeInput>))
-        return std::any_cast<std::shared_ptr<NativeInput>>(obj)->to_string();
-
-    if (obj.type() == typeid(std::shared_ptr<NativeExit>))
-        return std::any_cast<std::shared_ptr<NativeExit>>(obj)->to_string();
+    for (Expr* argument : arguments)
+        callee.define(evaluate(argument));
 
-    if (obj.type() == typeid(std::shared_ptr<NativeFloorDiv>))
-        return std::any_cast<std::shared_ptr<NativeFloorDiv>>(obj)->to_string();
-
-    if (obj.type() == typeid(std::shared_ptr<NativeArrayLen>))
-        return std::any_cast<std::shared_ptr<NativeArrayLen>>(obj)->to_string();
-
-    if (obj.type() == typeid(std::shared_ptr<ListType>))
-    {
-        std::string result = "[";
-        std::shared_ptr<ListType> list = std::any_cast<std::shared_ptr<ListType>>(obj);
-        std::vector<std::any> elements = list->elements;
+    return function->run(*this, frame);
+}
 
-        for (auto i = elements.begin(); i != elements.end(); i++)
-        {
-            auto next = i + 1;
+Value Interpreter::tail_call(NblFunction* function, const Value& receiver, const std::vector<Expr*>& arguments)
+{
+    // the arguments still need the caller's frame, the call waits until the caller's body has returned
+    std::vector<Value> values;
+    values.reserve(arguments.size());
 
-            result.append(stringify(*i));
+    for (Expr* argument : arguments)
+        values.push_back(evaluate(argument));
 
-            if (next != elements.end())
-                result.append(", ");
-        }
+    tail_function = function;
+    tail_receiver = receiver;
+    tail_arguments = std::move(values);
+    return nullptr;
+}
 
-        result.append("]");
-        return result;
-    }
+void Interpreter::check_num_operand(const Token& op, const Value& operand)
+{
+    // check if operand is a number
+    if (operand.is_number())
+        return;
+    
+    throw RuntimeError{op, "Operand must be a number"};
+}
 
-    return "Error in stringify: Invalid object type";
+void Interpreter::check_num_operands(const Token& op, const Value& left, const Value& right)
+{
+    // check if operands are numbers
+    if (left.is_number() && right.is_number())
+        return;
+    
+    throw RuntimeError{op, "Operands must be numbers"};
 }
@@ -3,23 +3,213 @@
 // Licensed under Apache License v2.0
 //------------------------------------//
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "lexer.hpp"
 #include "error.hpp"
 
-Lexer::Lexer(std::string source) : source(source) {}
+// the long runs (blanks, comments, words, digits, string bodies) are scanned a block of bytes at a time
+// with AVX2 or SSE2 when the compiler targets them, and a byte at a time for the tail or without them
+#if defined(__AVX2__)
+#define HAS_BLOCKS
+typedef __m256i Block;
+static const uint32_t BLOCK_MASK = 0xFFFFFFFF; // one bit per byte of a block
+static const int BLOCK_SIZE = 32;
+
+static inline Block load(const char* bytes) { return _mm256_loadu_si256(reinterpret_cast<const Block*>(bytes)); }
+static inline Block splat(char c) { return _mm256_set1_epi8(c); }
+static inline Block equal(Block a, Block b) { return _mm256_cmpeq_epi8(a, b); }
+static inline Block greater(Block a, Block b) { return _mm256_cmpgt_epi8(a, b); } // signed bytes
+static inline Block either(Block a, Block b) { return _mm256_or_si256(a, b); }
+static inline Block both(Block a, Block b) { return _mm256_and_si256(a, b); }
+static inline uint32_t bits(Block a) { return _mm256_movemask_epi8(a); }
+#elif defined(__SSE2__)
+#define HAS_BLOCKS
+typedef __m128i Block;
+static const uint32_t BLOCK_MASK = 0xFFFF;
+static const int BLOCK_SIZE = 16;
+
+static inline Block load(const char* bytes) { return _mm_loadu_si128(reinterpret_cast<const Block*>(bytes)); }
+static inline Block splat(char c) { return _mm_set1_epi8(c); }
+static inline Block equal(Block a, Block b) { return _mm_cmpeq_epi8(a, b); }
+static inline Block greater(Block a, Block b) { return _mm_cmpgt_epi8(a, b); }
+static inline Block either(Block a, Block b) { return _mm_or_si128(a, b); }
+static inline Block both(Block a, Block b) { return _mm_and_si128(a, b); }
+static inline uint32_t bits(Block a) { return _mm_movemask_epi8(a); }
+#endif
+
+#ifdef HAS_BLOCKS
+// bytes from low to high, ascii only: bytes with the top bit set are negative
+static inline Block between(Block a, char low, char high)
+{
+    return both(greater(a, splat(low - 1)), greater(splat(high + 1), a));
+}
+#endif
+
+// classes of bytes a run is made of, contains() gives one bit per byte of a block
+struct Blank // newlines are left to scan_token, it counts the lines
+{
+    static bool contains(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+#ifdef HAS_BLOCKS
+    static uint32_t contains(Block a) { return bits(either(either(equal(a, splat(' ')), equal(a, splat('\t'))), equal(a, splat('\r')))); }
+#endif
+};
+
+struct Digit
+{
+    static bool contains(char c) { return c >= '0' && c <= '9'; }
+#ifdef HAS_BLOCKS
+    static uint32_t contains(Block a) { return bits(between(a, '0', '9')); }
+#endif
+};
+
+struct Word // letters, digits, '_' and every byte of a utf-8 character
+{
+    static bool contains(char c) { return ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') || Digit::contains(c) || c == '_' || (c & 0x80) != 0; }
+#ifdef HAS_BLOCKS
+    static uint32_t contains(Block a)
+    {
+        Block letter = between(either(a, splat(0x20)), 'a', 'z');
+        // the top bits of the bytes themselves mark the utf-8 ones
+        return bits(either(either(letter, between(a, '0', '9')), equal(a, splat('_')))) | bits(a);
+    }
+#endif
+};
+
+struct CommentBody
+{
+    static bool contains(char c) { return c != '\n'; }
+#ifdef HAS_BLOCKS
+    static uint32_t contains(Block a) { return ~bits(equal(a, splat('\n'))); }
+#endif
+};
+
+struct StringBody // stops at newlines too, string() counts them
+{
+    static bool contains(char c) { return c != '"' && c != '\n'; }
+#ifdef HAS_BLOCKS
+    static uint32_t contains(Block a) { return ~bits(either(equal(a, splat('"')), equal(a, splat('\n')))); }
+#endif
+};
+
+// where the run of bytes of a class starting at start ends
+template <class Class>
+static int span(std::string_view text, int start)
+{
+    const char* bytes = text.data();
+    int end = static_cast<int>(text.size());
+    int i = start;
+
+#ifdef HAS_BLOCKS
+    // whole blocks only, a mapped source may end right at the end of a page
+    for (; i + BLOCK_SIZE <= end; i += BLOCK_SIZE)
+    {
+        uint32_t outside = ~Class::contains(load(bytes + i)) & BLOCK_MASK;
+
+        if (outside != 0)
+            return i + std::countr_zero(outside);
+    }
+#endif
+
+    while (i < end && Class::contains(bytes[i]))
+        i++;
+
+    return i;
+}
+
+// keywords by perfect hash: the first two letters and the length give every keyword its own slot
+struct Keyword
+{
+    std::string_view word;
+    TokenType type;
+};
+
+static constexpr Keyword KEYWORDS[] = {
+    {"and", TokenType::AND},
+    {"break", TokenType::BREAK},
+    {"class", TokenType::CLASS},
+    {"else", TokenType::ELSE},
+    {"false", TokenType::FALSE},
+    {"for", TokenType::FOR},
+    {"fun", TokenType::FUN},
+    {"if", TokenType::IF},
+    {"nil", TokenType::NIL},
+    {"or", TokenType::OR},
+    {"print", TokenType::PRINT},
+    {"return", TokenType::RETURN},
+    {"super", TokenType::SUPER},
+    {"this", TokenType::THIS},
+    {"true", TokenType::TRUE},
+    {"mut", TokenType::MUT},
+    {"while", TokenType::WHILE},
+    {"import", TokenType::IMPORT}
+};
+
+static const size_t KEYWORD_SLOTS = 32;
+
+static constexpr size_t keyword_slot(std::string_view word)
+{
+    return (static_cast<unsigned char>(word[0]) + static_cast<unsigned char>(word[1]) + word.size()) % KEYWORD_SLOTS;
+}
+
+static constexpr std::array<Keyword, KEYWORD_SLOTS> KEYWORD_TABLE = []
+{
+    std::array<Keyword, KEYWORD_SLOTS> table{};
+
+    for (Keyword& slot : table)
+        slot = {"", TokenType::IDENTIFIER};
+
+    for (const Keyword& keyword : KEYWORDS)
+        table[keyword_slot(keyword.word)] = keyword;
+
+    return table;
+}();
+
+static_assert(std::count_if(KEYWORD_TABLE.begin(), KEYWORD_TABLE.end(), [](const Keyword& slot) { return !slot.word.empty(); })
+              == static_cast<long>(std::size(KEYWORDS)), "two keywords share a slot, change keyword_slot");
+
+static TokenType keyword(std::string_view word)
+{
+    if (word.size() < 2)
+        return TokenType::IDENTIFIER;
+
+    const Keyword& slot = KEYWORD_TABLE[keyword_slot(word)];
+    return slot.word == word ? slot.type : TokenType::IDENTIFIER;
+}
+
+Lexer::Lexer(uint32_t source)
+    : source_index(source), module(Source::get(source)), source(module.text) {}
 
 std::vector<Token> Lexer::scan_tokens()
 {
+    // ordinary code has a token every three or four bytes, growing the vector copies every token made so far
+    tokens.reserve(source.size() / 4);
+
     // main loop
     while (!is_at_end())
     {
+        // mostly indentation, skipped a block at a time
+        current = span<Blank>(source, current);
+
+        if (is_at_end())
+            break;
+
         start = current;
         scan_token();
     }
 
     // end of line token
-    tokens.emplace_back(TokenType::TOKEN_EOF, "", nullptr, line);
-    return tokens;
+    tokens.emplace_back(TokenType::TOKEN_EOF, line);
+    return std::move(tokens); // a lexer scans once, the tokens are handed over instead of copied
 }
 
 bool Lexer::is_at_end() const
@@ -83,26 +273,23 @@ char Lexer::peek_next()
     return source[current + 1];
 }
 
-void Lexer::add_token(TokenType type, std::any literal)
-{
-    // grab the text and data of the current lexeme and creates a new token for it
-    tokens.emplace_back(type, source.substr(start, current - start), literal, line);
-}
-
 void Lexer::add_token(TokenType type)
 {
-    add_token(type, nullptr);
+    // the token only records where the current lexeme is
+    uint16_t column = std::min(start - line_start + 1, static_cast<int>(UINT16_MAX));
+    tokens.emplace_back(type, source_index, start, current - start, line, column);
 }
 
 void Lexer::string()
 {
-    // while not reached second quote or end of source code
-    while (peek() != '"' && !is_at_end())
-    {
-        if (peek() == '\n')
-            ++line;
+    // runs up to the second quote, stopping at each newline to count it
+    current = span<StringBody>(source, current);
 
-        advance();
+    while (!is_at_end() && source[current] == '\n')
+    {
+        ++line;
+        line_start = ++current;
+        current = span<StringBody>(source, current);
     }
 
     // unterminated string
@@ -114,17 +301,14 @@ void Lexer::string()
 
     advance(); // consume the closing '"'
 
-    // trim surrounding quotes with substring
-    add_token(TokenType::STRING, source.substr(start + 1, current - start - 2));
+    // the value is the text between the quotes, Token::string() trims them
+    add_token(TokenType::STRING);
 }
 
 void Lexer::number()
 {
-    // while the next character to consume is a digit
-    while (std::isdigit(peek()))
-    {
-        advance(); // consume
-    }
+    // the first digit was consumed by scan_token
+    current = span<Digit>(source, current);
 
     // look for a decimal point
     if (peek() == '.' && std::isdigit(peek_next()))
@@ -132,26 +316,24 @@ void Lexer::number()
         advance(); // move pass the decimal point
 
         // continue consuming the digits
-        while (std::isdigit(peek()))
-            advance();
+        current = span<Digit>(source, current);
     }
 
-    add_token(TokenType::NUMBER, std::stod(source.substr(start, current - start)));
+    // the value goes in the module's side table
+    double value = 0;
+    std::from_chars(source.data() + start, source.data() + current, value);
+    add_token(TokenType::NUMBER);
+    tokens.back().literal = module.numbers.size();
+    module.numbers.push_back(value);
 }
 
 void Lexer::identifier()
 {
-    // check for utf-8 characters
-    while (std::isalnum(peek()) || peek() == '_' || (peek() & 0x80) != 0)
-        advance(); // consume
+    // letters, digits, '_' and utf-8 characters
+    current = span<Word>(source, current);
 
-    const auto text = source.substr(start, current - start); // the word currently being evaluated
-    const auto match = keywords.find(text); // find identifier token
-
-    if (match != keywords.end()) // if found a match
-        add_token(match->second);
-    else
-        add_token(TokenType::IDENTIFIER); // default to returning the identifier token type
+    // the word currently being evaluated, a view into the source
+    add_token(keyword(source.substr(start, current - start)));
 }
 
 void Lexer::scan_token()
@@ -204,9 +386,8 @@ void Lexer::scan_token()
         case '/':
             if (match('/')) // if the next char is also a '/'
             {
-                // comment goes until the end of the line
-                while (peek() != '\n' && !is_at_end())
-                    advance(); // keep consuming characters till the end of the line
+                // comment goes until the end of the line, the newline is left for the next token
+                current = span<CommentBody>(source, current);
             }
             else
             {
@@ -221,6 +402,7 @@ void Lexer::scan_token()
 
         case '\n':
             line++; // new line
+            line_start = current;
             break;
 
         // string literal recognition
@@ -239,24 +421,3 @@ void Lexer::scan_token()
             break;
     }
 }
-
-const std::map<std::string, TokenType> Lexer::keywords = {
-    {"and", TokenType::AND},
-    {"break", TokenType::BREAK},
-    {"class", TokenType::CLASS},
-    {"else", TokenType::ELSE},
-    {"false", TokenType::FALSE},
-    {"for", TokenType::FOR},
-    {"fun", TokenType::FUN},
-    {"if", TokenType::IF},
-    {"nil", TokenType::NIL},
-    {"or", TokenType::OR},
-    {"print", TokenType::PRINT},
-    {"return", TokenType::RETURN},
-    {"super", TokenType::SUPER},
-    {"this", TokenType::THIS},
-    {"true", TokenType::TRUE},
-    {"mut", TokenType::MUT},
-    {"while", TokenType::WHILE},
-    {"import", TokenType::IMPORT}
-};
@@ -4,13 +4,30 @@
 //------------------------------------//
 
 #include "list.hpp"
+#include "heap.hpp"
 
-void ListType::append(std::any value)
+ListType::ListType()
 {
-    elements.push_back(value);
+    Heap::track(this);
 }
 
-std::any ListType::get_element_at(int index)
+void ListType::trace(Tracer& tracer)
+{
+    for (const Value& element : elements)
+        tracer.visit(element);
+}
+
+void ListType::clear()
+{
+    elements.clear();
+}
+
+void ListType::append(Value value)
+{
+    elements.push_back(std::move(value));
+}
+
+Value ListType::get_element_at(int index)
 {
     return elements.at(index);
 }
@@ -20,12 +37,12 @@ int ListType::get_length()
     return elements.size();
 }
 
-bool ListType::set_element_at(int index, std::any value)
+bool ListType::set_element_at(int index, Value value)
 {
     if (index == get_length())
-        elements.insert(elements.begin() + index, value);
+        elements.push_back(std::move(value));
     else if (index < get_length() && index >= 0)
-        elements[index] = value;
+        elements[index] = std::move(value);
     else
         return false;
     
@@ -6,19 +6,104 @@
 #include <iostream>
 
 #include "util.hpp"
+#include "vm.hpp"
+#include "closure_engine.hpp"
+#include "heap.hpp"
+#include "budget.hpp"
+#include "depth.hpp"
 
-Interpreter interpreter{};
+// a byte count with an optional K, M or G suffix
+static size_t parse_size(const char* text)
+{
+    char* suffix;
+    size_t size = strtoull(text, &suffix, 10);
+
+    switch (*suffix)
+    {
+        case 'G': case 'g': return size << 30;
+        case 'M': case 'm': return size << 20;
+        case 'K': case 'k': return size << 10;
+        default: return size;
+    }
+}
 
 int main(int argc, char* argv[])
 {
-    if (argc > 2) // too many arguments
+    std::string engine_name = "tree";
+    std::vector<char*> args; // everything that isn't a flag
+    size_t max_heap = 0;
+    size_t max_steps = 0;
+    bool gc_stats = false;
+
+    // reported at exit, scripts can end through exit() while the engine still holds it
+    static Heap heap;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--engine=", 9) == 0)
+            engine_name = argv[i] + 9;
+        else if (strcmp(argv[i], "--cache-stats") == 0)
+            std::atexit(InlineCache::print_stats); // scripts can end through exit(), so print from there
+        else if (strcmp(argv[i], "--phase-times") == 0)
+            std::atexit(PhaseTimes::print);
+        else if (strcmp(argv[i], "--gc-stats") == 0)
+            gc_stats = true;
+        else if (strncmp(argv[i], "--gc-threshold=", 15) == 0)
+            heap.set_threshold(std::max(1, atoi(argv[i] + 15)));
+        else if (strncmp(argv[i], "--max-heap=", 11) == 0)
+            max_heap = parse_size(argv[i] + 11);
+        else if (strncmp(argv[i], "--max-steps=", 12) == 0)
+            max_steps = parse_size(argv[i] + 12);
+        else if (strncmp(argv[i], "--max-call-depth=", 17) == 0)
+            CallDepth::set_limit(std::max<size_t>(1, parse_size(argv[i] + 17)));
+        else
+            args.push_back(argv[i]);
+    }
+
+    std::unique_ptr<Engine> engine;
+
+    if (engine_name == "tree") // tree-walking interpreter
+    {
+        engine = std::make_unique<Interpreter>(heap);
+    }
+    else if (engine_name == "vm") // bytecode compiler and vm
+    {
+        engine = std::make_unique<VM>(heap);
+    }
+    else if (engine_name == "closure") // tree compiled into closures
+    {
+        engine = std::make_unique<ClosureEngine>(heap);
+    }
+    else
+    {
+        std::cout << "Unknown engine '" + engine_name + "', use 'tree', 'vm' or 'closure'\n";
+        exit(1);
+    }
+
+    if (max_steps != 0)
+        engine->budget.set_limit(max_steps);
+
+    if (gc_stats)
+        std::atexit([] { heap.print_stats(); });
+
+    // set once the engine is built, so a tiny limit fails the program instead of the startup
+    // the peak is reported with the collector stats if those were asked for
+    if (max_heap != 0)
+    {
+        heap.set_limit(max_heap);
+
+        if (!gc_stats)
+            std::atexit([] { heap.print_usage(); });
+    }
+
+    if (args.size() > 1) // too many arguments
     {
-        std::cout << "Usage: nimble <script>.nbl\n";
+        std::cout << "Usage: nimble [--engine=tree|vm|closure] [--cache-stats] [--phase-times] [--gc-stats] [--gc-threshold=<objects>] [--max-heap=<bytes>[K|M|G]] [--max-steps=<steps>[K|M|G]] [--max-call-depth=<calls>] <script>.nbl\n";
         exit(1);
     }
-    else if (argc == 2) // run script file
+    else if (args.size() == 1) // run script file
     {
-        char* point = strrchr(argv[1], '.');
+        char* point = strrchr(args[0], '.');
 
         if(point != NULL)
         {
@@ -34,11 +119,12 @@ int main(int argc, char* argv[])
             exit(1);
         }
 
-        run_file(argv[1], interpreter);
+        // the engine is freed on the same stack, releasing a long chain of objects recurses as deep as the chain
+        CallDepth::run([&] { run_file(args[0], *engine); engine.reset(); });
     }
     else // run interactive mode
     {
-        run_prompt(interpreter);
+        CallDepth::run([&] { run_prompt(*engine); engine.reset(); });
         // prompt_load("./example/function/function-8.nbl");
     }
 
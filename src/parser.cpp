@@ -5,45 +5,39 @@
 
 #include "parser.hpp"
 
-Parser::Parser(const std::vector<Token>& tokens)
-    : tokens(tokens) {}
+Parser::Parser(const std::vector<Token>& tokens, Ast& ast)
+    : tokens(tokens), ast(ast) {}
 
-std::vector<std::shared_ptr<Stmt>> Parser::parse()
+void Parser::parse()
 {
-    std::vector<std::shared_ptr<Stmt>> statements;
-
     while (!is_at_end())
     {
-        // statements.push_back(statement());
-        statements.push_back(declaration());
+        // ast.statements.push_back(statement());
+        ast.statements.push_back(declaration());
     }
-
-    return statements;
 }
 
-std::any Parser::parse_repl()
+void Parser::parse_repl()
 {
     allow_expression = true;
-    std::vector<std::shared_ptr<Stmt>> statements;
 
     while (!is_at_end())
     {
-        statements.push_back(declaration());
+        ast.statements.push_back(declaration());
 
         if (found_expression)
         {
-            std::shared_ptr<Stmt> last = statements.back();
-            return std::dynamic_pointer_cast<ExpressionStmt>(last)->expression;
+            Stmt* last = ast.statements.back();
+            ast.expression = static_cast<ExpressionStmt*>(last)->expression;
+            return;
         }
 
         allow_expression = false;
     }
-
-    return statements;
 }
 
 
-std::shared_ptr<Stmt> Parser::statement()
+Stmt* Parser::statement()
 {
     if (match(PRINT))
         return print_statement();
@@ -67,45 +61,43 @@ std::shared_ptr<Stmt> Parser::statement()
         return import_statement();
 
     if (match(LEFT_BRACE))
-        return std::make_shared<BlockStmt>(block());
+        return ast.make<BlockStmt>(block());
     
     return expression_statement();
 }
 
-std::shared_ptr<Stmt> Parser::print_statement()
+Stmt* Parser::print_statement()
 {
     consume(LEFT_PAREN, "Expected '(' after 'print' statement");
-    // shared_ptr used here be cause it's accessing another shared_ptr object already created by expression()
-    std::shared_ptr<Expr> value = expression();
+    Expr* value = expression();
     consume(RIGHT_PAREN, "Missing ')' for 'print' statement");
     consume(SEMICOLON, "Expected ';' after value");
 
-    // make_shared combines allocation of the object and control block into a single memory allocation
-    // more efficient and better exception safety
-    return std::make_shared<PrintStmt>(value);
+    // nodes are cut from the module's arena, the tree frees them all at once
+    return ast.make<PrintStmt>(value);
 }
 
-std::shared_ptr<Stmt> Parser::if_statement()
+Stmt* Parser::if_statement()
 {
     consume(LEFT_PAREN, "Expected '(' after 'if' statement");
-    std::shared_ptr<Expr> condition = expression();
+    Expr* condition = expression();
     consume(RIGHT_PAREN, "Expected ')' after 'if' condition");
 
-    std::shared_ptr<Stmt> then_branch = statement();
-    std::shared_ptr<Stmt> else_branch = nullptr;
+    Stmt* then_branch = statement();
+    Stmt* else_branch = nullptr;
 
     if (match(ELSE))
         else_branch = statement();
 
-    return std::make_shared<IfStmt>(condition, then_branch, else_branch);
+    return ast.make<IfStmt>(condition, then_branch, else_branch);
 }
 
-std::shared_ptr<Stmt> Parser::for_statement()
+Stmt* Parser::for_statement()
 {
     try 
     {
         consume(LEFT_PAREN, "Expected '(' after 'for' statement");
-        std::shared_ptr<Stmt> initializer;
+        Stmt* initializer;
 
         if (match(SEMICOLON)) // initializer omitted
             initializer = nullptr;
@@ -114,30 +106,30 @@ std::shared_ptr<Stmt> Parser::for_statement()
         else // expression
             initializer = expression_statement();
 
-        std::shared_ptr<Expr> condition = nullptr;
+        Expr* condition = nullptr;
         if (!check(SEMICOLON)) // clause not omitted
             condition = expression();
         consume(SEMICOLON, "Expected ';' after loop condition");
         
-        std::shared_ptr<Expr> increment = nullptr;
+        Expr* increment = nullptr;
         if (!check(RIGHT_PAREN)) // clause not omitted
             increment = expression();
         consume(RIGHT_PAREN, "Expected ')' after 'for' clauses");
 
-        std::shared_ptr<Stmt> body = statement();
+        Stmt* body = statement();
         if (increment != nullptr)
             // executes after the body in each iteration of the loop
             // replace body with a block that contains the original body with an expression statement that evaluates the increment
-            body = std::make_shared<BlockStmt>(std::vector<std::shared_ptr<Stmt>>{body, std::make_shared<ExpressionStmt>(increment)});
+            body = ast.make<BlockStmt>(std::vector<Stmt*>{body, ast.make<ExpressionStmt>(increment)});
 
         if (condition == nullptr)
             // true if condition is omitted
-            condition = std::make_shared<LiteralExpr>(true);
-        body = std::make_shared<WhileStmt>(condition, body); // build for loop with while loop
+            condition = ast.make<LiteralExpr>(true);
+        body = ast.make<WhileStmt>(condition, body); // build for loop with while loop
 
         if (initializer != nullptr) // runs once
             // replace statement with a block that runs the initializer and execute the loop
-            body = std::make_shared<BlockStmt>(std::vector<std::shared_ptr<Stmt>>{initializer, body});
+            body = ast.make<BlockStmt>(std::vector<Stmt*>{initializer, body});
 
         return body;
     }
@@ -150,18 +142,18 @@ std::shared_ptr<Stmt> Parser::for_statement()
     loop_depth--;
 }
 
-std::shared_ptr<Stmt> Parser::while_statement()
+Stmt* Parser::while_statement()
 {
     try
     {
         loop_depth++;
 
         consume(LEFT_PAREN, "Expected '(' after 'while' statement");
-        std::shared_ptr<Expr> condition = expression();
+        Expr* condition = expression();
         consume(RIGHT_PAREN, "Expected ')' after 'while' condition");
-        std::shared_ptr<Stmt> body = statement();
+        Stmt* body = statement();
 
-        return std::make_shared<WhileStmt>(condition, body);
+        return ast.make<WhileStmt>(condition, body);
     }
     catch (...) // throw error for trying to use break outside a loop
     {
@@ -172,50 +164,50 @@ std::shared_ptr<Stmt> Parser::while_statement()
     loop_depth--;
 }
 
-std::shared_ptr<Stmt> Parser::return_statement()
+Stmt* Parser::return_statement()
 {
     Token keyword = previous();
-    std::shared_ptr<Expr> value = nullptr;
+    Expr* value = nullptr;
     
     if (!check(SEMICOLON))
         value = expression();
     consume(SEMICOLON, "Expected ';' after return value");
 
-    return std::make_shared<ReturnStmt>(keyword, value);
+    return ast.make<ReturnStmt>(keyword, value);
 }
 
-std::shared_ptr<Stmt> Parser::break_statement()
+Stmt* Parser::break_statement()
 {
     if (loop_depth == 0)
         error(previous(), "Must be inside a loop to use 'break'");
     consume(SEMICOLON, "Expected ';' after 'break'");
 
-    return std::make_shared<BreakStmt>();
+    return ast.make<BreakStmt>();
 }
 
-std::shared_ptr<Stmt> Parser::import_statement()
+Stmt* Parser::import_statement()
 {
     Token keyword = previous();
     Token target = consume(STRING, "Expected filename after 'import'");
     consume(SEMICOLON, "Expected ';' after 'import' statement");
-    return std::make_shared<ImportStmt>(keyword, std::make_shared<LiteralExpr>(target.literal));
+    return ast.make<ImportStmt>(keyword, ast.make<LiteralExpr>(std::string(target.string())));
 }
 
-std::shared_ptr<Stmt> Parser::expression_statement()
+Stmt* Parser::expression_statement()
 {
-    std::shared_ptr<Expr> expr = expression();
+    Expr* expr = expression();
 
     if (allow_expression && is_at_end())
         found_expression = true;
     else
         consume(SEMICOLON, "Expected ';' after expression");
 
-    return std::make_shared<ExpressionStmt>(expr);
+    return ast.make<ExpressionStmt>(expr);
 }
 
-std::vector<std::shared_ptr<Stmt>> Parser::block()
+std::vector<Stmt*> Parser::block()
 {
-    std::vector<std::shared_ptr<Stmt>> statements;
+    std::vector<Stmt*> statements;
 
     while (!check(RIGHT_BRACE) && !is_at_end())
         statements.push_back(declaration());
@@ -225,7 +217,7 @@ std::vector<std::shared_ptr<Stmt>> Parser::block()
     return statements;
 }
 
-std::shared_ptr<Stmt> Parser::declaration()
+Stmt* Parser::declaration()
 {
     try
     {
@@ -248,25 +240,25 @@ std::shared_ptr<Stmt> Parser::declaration()
     }
 }
 
-std::shared_ptr<Stmt> Parser::mut_declaration()
+Stmt* Parser::mut_declaration()
 {
     Token name = consume(IDENTIFIER, "Expected variable name");
 
-    std::shared_ptr<Expr> initializer = nullptr;
+    Expr* initializer = nullptr;
     if (match(EQUAL))
         initializer = expression();
 
     consume(SEMICOLON, "Expected ';' after variable declaration");
-    return std::make_shared<MutStmt>(std::move(name), initializer);
+    return ast.make<MutStmt>(std::move(name), initializer);
 }
 
-std::shared_ptr<FunctionStmt> Parser::function(std::string kind)
+FunctionStmt* Parser::function(std::string kind)
 {
     Token name = consume(IDENTIFIER, "Expected " + kind + " name");
-    return std::make_shared<FunctionStmt>(name, function_body(kind));
+    return ast.make<FunctionStmt>(name, function_body(kind));
 }
 
-std::shared_ptr<FunctionExpr> Parser::function_body(std::string kind)
+FunctionExpr* Parser::function_body(std::string kind)
 {
     consume(LEFT_PAREN, "Expected '(' after " + kind + " name");
 
@@ -284,56 +276,56 @@ std::shared_ptr<FunctionExpr> Parser::function_body(std::string kind)
     consume(RIGHT_PAREN, "Expected ')' after parameters");
 
     consume(LEFT_BRACE, "Expected '{' before " + kind + " body");
-    std::vector<std::shared_ptr<Stmt>> body = block();
+    std::vector<Stmt*> body = block();
 
-    return std::make_shared<FunctionExpr>(std::move(parameters), std::move(body));
+    return ast.make<FunctionExpr>(std::move(parameters), std::move(body));
 }
 
-std::shared_ptr<Stmt> Parser::class_declaration()
+Stmt* Parser::class_declaration()
 {
     Token name = consume(IDENTIFIER, "Expected class name");
 
-    std::shared_ptr<MutExpr> superclass = nullptr;
+    MutExpr* superclass = nullptr;
     if (match(COLON))
     {
         consume(IDENTIFIER, "Expected superclass name");
-        superclass = std::make_shared<MutExpr>(previous());
+        superclass = ast.make<MutExpr>(previous());
     }
 
     consume(LEFT_BRACE, "Expected '{' before class body");
-    std::vector<std::shared_ptr<FunctionStmt>> methods;
+    std::vector<FunctionStmt*> methods;
 
     while (!check(RIGHT_BRACE) && !is_at_end())
         methods.push_back(function("method"));
 
     consume(RIGHT_BRACE, "Expected '}' after class body");
 
-    return std::make_shared<ClassStmt>(std::move(name), std::move(superclass), std::move(methods));
+    return ast.make<ClassStmt>(std::move(name), std::move(superclass), std::move(methods));
 }
 
-std::shared_ptr<Expr> Parser::assignment()
+Expr* Parser::assignment()
 {
-    std::shared_ptr<Expr> expr = or_expression();
+    Expr* expr = or_expression();
 
     if (match(EQUAL))
     {
         Token equals = previous();
-        std::shared_ptr<Expr> value = assignment();
+        Expr* value = assignment();
 
-        if (std::shared_ptr<MutExpr> e = std::dynamic_pointer_cast<MutExpr>(expr))
+        if (MutExpr* e = dynamic_cast<MutExpr*>(expr))
         {
             Token name = e->name;
-            return std::make_shared<AssignExpr>(std::move(name), value);
+            return ast.make<AssignExpr>(std::move(name), value);
         }
-        else if (std::shared_ptr<GetExpr> g = std::dynamic_pointer_cast<GetExpr>(expr))
+        else if (GetExpr* g = dynamic_cast<GetExpr*>(expr))
         {
-            return std::make_shared<SetExpr>(g->object, g->name, value);
+            return ast.make<SetExpr>(g->object, g->name, value);
         }
-        else if (std::shared_ptr<SubscriptExpr> s = std::dynamic_pointer_cast<SubscriptExpr>(expr))
+        else if (SubscriptExpr* s = dynamic_cast<SubscriptExpr*>(expr))
         {
-            std::shared_ptr<Expr> name = s->name;
-            std::shared_ptr<Expr> index = s->index;
-            return std::make_shared<SubscriptExpr>(name, s->paren, index, value);
+            Expr* name = s->name;
+            Expr* index = s->index;
+            return ast.make<SubscriptExpr>(name, s->paren, index, value);
         }
 
         Error::error(std::move(equals), "Invalid assignment target");
@@ -348,31 +340,31 @@ std::shared_ptr<Expr> Parser::assignment()
     return expr;
 }
 
-std::shared_ptr<Expr> Parser::compound(std::shared_ptr<Expr> expr, Token op)
+Expr* Parser::compound(Expr* expr, Token op)
 {
-    std::shared_ptr<Expr> value = term();
+    Expr* value = term();
 
-    if (std::shared_ptr<MutExpr> e = std::dynamic_pointer_cast<MutExpr>(expr))
+    if (MutExpr* e = dynamic_cast<MutExpr*>(expr))
     {
         Token name = e->name;
-        std::shared_ptr<Expr> val = std::make_shared<BinaryExpr>(expr, op, value);
+        Expr* val = ast.make<BinaryExpr>(expr, op, value);
 
-        return std::make_shared<AssignExpr>(name, val);
+        return ast.make<AssignExpr>(name, val);
     }
-    else if (std::shared_ptr<GetExpr> g = std::dynamic_pointer_cast<GetExpr>(expr))
+    else if (GetExpr* g = dynamic_cast<GetExpr*>(expr))
     {
         Token name = g->name;
-        std::shared_ptr<Expr> val = std::make_shared<BinaryExpr>(expr, op, value);
+        Expr* val = ast.make<BinaryExpr>(expr, op, value);
 
-        return std::make_shared<SetExpr>(g->object, name, val);
+        return ast.make<SetExpr>(g->object, name, val);
     }
-    else if (std::shared_ptr<SubscriptExpr> s = std::dynamic_pointer_cast<SubscriptExpr>(expr))
+    else if (SubscriptExpr* s = dynamic_cast<SubscriptExpr*>(expr))
     {
-        std::shared_ptr<Expr> name = s->name;
-        std::shared_ptr<Expr> index = s->index;
-        std::shared_ptr<Expr> val = std::make_shared<BinaryExpr>(expr, op, value);
+        Expr* name = s->name;
+        Expr* index = s->index;
+        Expr* val = ast.make<BinaryExpr>(expr, op, value);
 
-        return std::make_shared<SubscriptExpr>(name, s->paren, index, val);
+        return ast.make<SubscriptExpr>(name, s->paren, index, val);
     }
 
     Error::error(op, "Invalid compound assignment target");
@@ -380,131 +372,131 @@ std::shared_ptr<Expr> Parser::compound(std::shared_ptr<Expr> expr, Token op)
     return expr;
 }
 
-std::shared_ptr<Expr> Parser::expression()
+Expr* Parser::expression()
 {
     return assignment(); // recursive descent
 }
 
-std::shared_ptr<Expr> Parser::or_expression()
+Expr* Parser::or_expression()
 {
-    std::shared_ptr<Expr> expression = and_expression();
+    Expr* expression = and_expression();
 
     while (match(OR))
     {
         Token op = previous();
-        std::shared_ptr<Expr> right = and_expression();
-        expression = std::make_shared<LogicalExpr>(expression, std::move(op), right);
+        Expr* right = and_expression();
+        expression = ast.make<LogicalExpr>(expression, std::move(op), right);
     }
 
     return expression;
 }
 
-std::shared_ptr<Expr> Parser::and_expression()
+Expr* Parser::and_expression()
 {
-    std::shared_ptr<Expr> expression = equality();
+    Expr* expression = equality();
 
     while (match(AND))
     {
         Token op = previous();
-        std::shared_ptr<Expr> right = equality();
-        expression = std::make_shared<LogicalExpr>(expression, std::move(op), right);
+        Expr* right = equality();
+        expression = ast.make<LogicalExpr>(expression, std::move(op), right);
     }
 
     return expression;
 }
 
-std::shared_ptr<Expr> Parser::equality()
+Expr* Parser::equality()
 {
-    std::shared_ptr<Expr> expr = comparison();
+    Expr* expr = comparison();
 
     while (match(BANG_EQUAL, EQUAL_EQUAL)) // find token
     {
         Token op = previous();
-        std::shared_ptr<Expr> right = comparison();
-        expr = std::make_shared<BinaryExpr>(expr, std::move(op), right);
+        Expr* right = comparison();
+        expr = ast.make<BinaryExpr>(expr, std::move(op), right);
     }
 
     return expr;
 }
 
-std::shared_ptr<Expr> Parser::comparison()
+Expr* Parser::comparison()
 {
-    std::shared_ptr<Expr> expr = exponent();
+    Expr* expr = exponent();
 
     while (match(GREATER, GREATER_EQUAL, LESS, LESS_EQUAL))
     {
         Token op = previous();
-        std::shared_ptr<Expr> right = exponent();
-        expr = std::make_shared<BinaryExpr>(expr, std::move(op), right);
+        Expr* right = exponent();
+        expr = ast.make<BinaryExpr>(expr, std::move(op), right);
     }
 
     return expr;
 }
 
-std::shared_ptr<Expr> Parser::exponent()
+Expr* Parser::exponent()
 {
-    std::shared_ptr<Expr> expr = term();
+    Expr* expr = term();
 
     while (match(TokenType::STAR_STAR))
     {
         Token op = previous();
-        std::shared_ptr<Expr> right = term();
-        expr = std::make_shared<BinaryExpr>(expr, std::move(op), right);
+        Expr* right = term();
+        expr = ast.make<BinaryExpr>(expr, std::move(op), right);
     }
 
     return expr;
 }
 
-std::shared_ptr<Expr> Parser::term()
+Expr* Parser::term()
 {
-    std::shared_ptr<Expr> expr = factor();
+    Expr* expr = factor();
 
     while (match(MINUS, PLUS))
     {
         Token op = previous();
-        std::shared_ptr<Expr> right = factor();
-        expr = std::make_shared<BinaryExpr>(expr, std::move(op), right);
+        Expr* right = factor();
+        expr = ast.make<BinaryExpr>(expr, std::move(op), right);
     }
 
     return expr;
 }
 
-std::shared_ptr<Expr> Parser::factor()
+Expr* Parser::factor()
 {
-    std::shared_ptr<Expr> expr = unary();
+    Expr* expr = unary();
 
     while (match(SLASH, STAR, PERCENT))
     {
         Token op = previous();
-        std::shared_ptr<Expr> right = unary();
-        expr = std::make_shared<BinaryExpr>(expr, std::move(op), right);
+        Expr* right = unary();
+        expr = ast.make<BinaryExpr>(expr, std::move(op), right);
     }
 
     return expr;
 }
 
-std::shared_ptr<Expr> Parser::unary()
+Expr* Parser::unary()
 {
     if (match(BANG, MINUS, PLUS))
     {
         Token op = previous();
-        std::shared_ptr<Expr> right = unary();
-        return std::make_shared<UnaryExpr>(std::move(op), right);
+        Expr* right = unary();
+        return ast.make<UnaryExpr>(std::move(op), right);
     }
 
     return call();
 }
 
-std::shared_ptr<Expr> Parser::finish_subscript(std::shared_ptr<Expr> name)
+Expr* Parser::finish_subscript(Expr* name)
 {
-    std::shared_ptr<Expr> index = or_expression();
+    Expr* index = or_expression();
     Token paren = consume(RIGHT_BRACKET, "Expected ']' after arguments");
-    return std::make_shared<SubscriptExpr>(name, paren, index, nullptr);
+    return ast.make<SubscriptExpr>(name, paren, index, nullptr);
 }
 
-std::shared_ptr<Expr> Parser::subscript()
+Expr* Parser::subscript()
 {
-    std::shared_ptr<Expr> expr = primary();
+    Expr* expr = primary();
 
     while (true)
     {
@@ -517,9 +509,9 @@ std::shared_ptr<Expr> Parser::subscript()
     return expr;
 }
 
-std::shared_ptr<Expr> Parser::finish_call(std::shared_ptr<Expr> callee)
+Expr* Parser::finish_call(Expr* callee)
 {
-    std::vector<std::shared_ptr<Expr>> arguments;
+    std::vector<Expr*> arguments;
 
     if (!check(RIGHT_PAREN))
     {
@@ -534,12 +526,12 @@ std::shared_ptr<Expr> Parser::finish_call(std::shared_ptr<Expr> callee)
 
     Token paren = consume(RIGHT_PAREN, "Expected ')' after arguments");
 
-    return std::make_shared<CallExpr>(callee, std::move(paren), std::move(arguments));
+    return ast.make<CallExpr>(callee, std::move(paren), std::move(arguments));
 }
 
-std::shared_ptr<Expr> Parser::call()
+Expr* Parser::call()
 {
-    std::shared_ptr<Expr> expr = subscript();
+    Expr* expr = subscript();
 
     while (true)
     {
@@ -550,7 +542,7 @@ std::shared_ptr<Expr> Parser::call()
         else if (match(DOT))
         {
             Token name = consume(IDENTIFIER, "Expected property name after '.'");
-            expr = std::make_shared<GetExpr>(expr, std::move(name));
+            expr = ast.make<GetExpr>(expr, std::move(name));
         }
         else if (match(LEFT_BRACKET)) // handle subscript
         {
@@ -565,9 +557,9 @@ std::shared_ptr<Expr> Parser::call()
     return expr;
 }
 
-std::shared_ptr<Expr> Parser::list_expression()
+Expr* Parser::list_expression()
 {
-    std::vector<std::shared_ptr<Expr>> values;
+    std::vector<Expr*> values;
 
     if (!match(RIGHT_BRACKET))
     {
@@ -576,41 +568,44 @@ std::shared_ptr<Expr> Parser::list_expression()
             if (values.size() >= 255)
                 error(peek(), "Can't have more than 255 elements in a list");
 
-            std::shared_ptr<Expr> value = or_expression();
+            Expr* value = or_expression();
             values.push_back(value);
         } while (match(COMMA));
     }
     else
     {
-        return std::make_shared<ListExpr>(values);
+        return ast.make<ListExpr>(values);
     }
 
     consume(RIGHT_BRACKET, "Expected ']' at the end of a list");
-    return std::make_shared<ListExpr>(values);
+    return ast.make<ListExpr>(values);
 }
 
-std::shared_ptr<Expr> Parser::primary()
+Expr* Parser::primary()
 {
     if (match(FALSE))
-        return std::make_shared<LiteralExpr>(false);
+        return ast.make<LiteralExpr>(false);
 
     if (match(TRUE))
-        return std::make_shared<LiteralExpr>(true);
+        return ast.make<LiteralExpr>(true);
 
     if (match(NIL))
-        return std::make_shared<LiteralExpr>(nullptr);
+        return ast.make<LiteralExpr>(nullptr);
         
-    if (match(NUMBER, STRING))
-        return std::make_shared<LiteralExpr>(previous().literal);
+    if (match(NUMBER))
+        return ast.make<LiteralExpr>(previous().number());
+
+    if (match(STRING))
+        return ast.make<LiteralExpr>(std::string(previous().string()));
 
     if (match(IDENTIFIER))
-        return std::make_shared<MutExpr>(previous());
+        return ast.make<MutExpr>(previous());
 
     if (match(FUN))
         return function_body("function");
 
     if (match(THIS))
-        return std::make_shared<ThisExpr>(previous());
+        return ast.make<ThisExpr>(previous());
 
     if (match(LEFT_BRACKET))
         return list_expression();
@@ -620,14 +615,14 @@ std::shared_ptr<Expr> Parser::primary()
         Token keyword = previous();
         consume(DOT, "Expected '.' after 'super'");
         Token method = consume(IDENTIFIER, "Expected superclass method name");
-        return std::make_shared<SuperExpr>(std::move(keyword), std::move(method));
+        return ast.make<SuperExpr>(std::move(keyword), std::move(method));
     }
 
     if (match(LEFT_PAREN))
     {
-        std::shared_ptr<Expr> expr = expression();
+        Expr* expr = expression();
         consume(RIGHT_PAREN, "Expect ')' after expression");
-        return std::make_shared<GroupingExpr>(expr);
+        return ast.make<GroupingExpr>(expr);
     }
 
     // token that can't start an expression
@@ -650,14 +645,14 @@ bool Parser::match(T... type)
     return false;
 }
 
-Token Parser::consume(TokenType type, std::string msg)
+const Token& Parser::consume(TokenType type, std::string_view msg)
 {
     // if is of known token type
     if (check(type))
         return advance();
 
     // throw an error if token type is not recognized
-    throw error(peek(), msg);
+    throw error(peek(), std::string(msg));
 }
 
 bool Parser::check(TokenType type)
@@ -670,7 +665,7 @@ bool Parser::check(TokenType type)
     return peek().type == type;
 }
 
-Token Parser::advance()
+const Token& Parser::advance()
 {
     // consumes current token and returns it
     if (!is_at_end())
@@ -685,16 +680,16 @@ bool Parser::is_at_end()
     return peek().type == TOKEN_EOF;
 }
 
-Token Parser::peek()
+const Token& Parser::peek()
 {
     // get current token that the parser hasn't consumed
-    return tokens.at(current);
+    return tokens[current];
 }
 
-Token Parser::previous()
+const Token& Parser::previous()
 {
     // get recently consumed token
-    return tokens.at(current - 1);
+    return tokens[current - 1];
 }
 
 ParseError Parser::error(const Token& token, std::string msg)
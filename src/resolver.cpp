@@ -5,112 +5,112 @@
 
 #include "resolver.hpp"
 
-Resolver::Resolver(Interpreter& interpreter, std::string& executed_path)
-    : interpreter(interpreter), executed_path(executed_path) {}
+Resolver::Resolver(std::string& executed_path)
+    : executed_path(executed_path) {}
 
-void Resolver::resolve(const std::vector<std::shared_ptr<Stmt>>& statements)
+void Resolver::resolve(const std::vector<Stmt*>& statements)
 {
-    for (const std::shared_ptr<Stmt>& statement : statements)
+    for (Stmt* statement : statements)
         resolve(statement);
 }
 
 
-std::any Resolver::visitAssignExpr(std::shared_ptr<AssignExpr> expr)
+Value Resolver::visitAssignExpr(AssignExpr* expr)
 {
     resolve(expr->value);
-    resolve_local(expr, expr->name);
+    resolve_local(expr->local, expr->name.lexeme());
     return {};
 }
 
-std::any Resolver::visitBinaryExpr(std::shared_ptr<BinaryExpr> expr)
+Value Resolver::visitBinaryExpr(BinaryExpr* expr)
 {
     resolve(expr->left);
     resolve(expr->right);
     return {};
 }
 
-std::any Resolver::visitGroupingExpr(std::shared_ptr<GroupingExpr> expr)
+Value Resolver::visitGroupingExpr(GroupingExpr* expr)
 {
     resolve(expr->expression);
     return {};
 }
 
-std::any Resolver::visitLiteralExpr(std::shared_ptr<LiteralExpr> expr)
+Value Resolver::visitLiteralExpr(LiteralExpr* expr)
 {
     return {};
 }
 
-std::any Resolver::visitUnaryExpr(std::shared_ptr<UnaryExpr> expr)
+Value Resolver::visitUnaryExpr(UnaryExpr* expr)
 {
     resolve(expr->right);
     return {};
 }
 
-std::any Resolver::visitMutExpr(std::shared_ptr<MutExpr> expr)
+Value Resolver::visitMutExpr(MutExpr* expr)
 {
     if (!scopes.empty())
     {
         auto& current_scope = scopes.back();
-        auto element = current_scope.find(expr->name.lexeme);
+        auto element = current_scope.find(expr->name.lexeme());
 
-        if (element != current_scope.end() && element->second == false)
+        if (element != current_scope.end() && !element->second.defined)
             Error::error(expr->name, "Can't read local variable in its initializer");
 
     }
-    resolve_local(expr, expr->name);
+    resolve_local(expr->local, expr->name.lexeme());
     return {};
 }
 
-std::any Resolver::visitLogicalExpr(std::shared_ptr<LogicalExpr> expr)
+Value Resolver::visitLogicalExpr(LogicalExpr* expr)
 {
     resolve(expr->left);
     resolve(expr->right);
     return {};
 }
 
-std::any Resolver::visitCallExpr(std::shared_ptr<CallExpr> expr)
+Value Resolver::visitCallExpr(CallExpr* expr)
 {
     resolve(expr->callee);
 
-    for (const std::shared_ptr<Expr>& argument : expr->arguments)
+    for (Expr* argument : expr->arguments)
         resolve(argument);
 
     return {};
 }
 
-std::any Resolver::visitFunctionExpr(std::shared_ptr<FunctionExpr> expr)
+Value Resolver::visitFunctionExpr(FunctionExpr* expr)
 {
     resolve_function(expr, FunctionType::FUNCTION);
     return {};
 }
 
-std::any Resolver::visitGetExpr(std::shared_ptr<GetExpr> expr)
+Value Resolver::visitGetExpr(GetExpr* expr)
 {
     resolve(expr->object);
     return {};
 }
 
-std::any Resolver::visitSetExpr(std::shared_ptr<SetExpr> expr)
+Value Resolver::visitSetExpr(SetExpr* expr)
 {
     resolve(expr->value);
     resolve(expr->object);
     return {};
 }
 
-std::any Resolver::visitThisExpr(std::shared_ptr<ThisExpr> expr)
+Value Resolver::visitThisExpr(ThisExpr* expr)
 {
     if (current_class == ClassType::NONE)
     {
         Error::error(expr->keyword, "Can't use 'this' outside of a class");
         return {};
     }
-    resolve_local(expr, expr->keyword);
+    resolve_local(expr->local, expr->keyword.lexeme());
 
     return {};
 }
 
 
-std::any Resolver::visitSuperExpr(std::shared_ptr<SuperExpr> expr)
+Value Resolver::visitSuperExpr(SuperExpr* expr)
 {
     // check if we're currently in a scope where super is allowed
     if (current_class == ClassType::NONE)
@@ -118,18 +118,19 @@ std::any Resolver::visitSuperExpr(std::shared_ptr<SuperExpr> expr)
     else if (current_class != ClassType::SUBCLASS)
         Error::error(expr->keyword, "Can't use 'super' in a class with no superclass");
 
-    resolve_local(expr, expr->keyword);
+    resolve_local(expr->local, expr->keyword.lexeme());
+    resolve_local(expr->receiver, "this");
     return {};
 }
 
-std::any Resolver::visitListExpr(std::shared_ptr<ListExpr> expr)
+Value Resolver::visitListExpr(ListExpr* expr)
 {
-    for (std::shared_ptr<Expr> element : expr->elements)
+    for (Expr* element : expr->elements)
         resolve(element);
     return {};
 }
 
-std::any Resolver::visitSubscriptExpr(std::shared_ptr<SubscriptExpr> expr)
+Value Resolver::visitSubscriptExpr(SubscriptExpr* expr)
 {
     resolve(expr->name);
     resolve(expr->index);
@@ -140,27 +141,28 @@ std::any Resolver::visitSubscriptExpr(std::shared_ptr<SubscriptExpr> expr)
     return {};
 }
 
-std::any Resolver::visitBlockStmt(std::shared_ptr<BlockStmt> stmt)
+Completion Resolver::visitBlockStmt(BlockStmt* stmt)
 {
     begin_scope();
     resolve(stmt->statements);
+    stmt->slot_count = scopes.back().size();
     end_scope();
     return {};
 }
 
-std::any Resolver::visitExpressionStmt(std::shared_ptr<ExpressionStmt> stmt)
+Completion Resolver::visitExpressionStmt(ExpressionStmt* stmt)
 {
     resolve(stmt->expression);
     return {};
 }
 
-std::any Resolver::visitPrintStmt(std::shared_ptr<PrintStmt> stmt)
+Completion Resolver::visitPrintStmt(PrintStmt* stmt)
 {
     resolve(stmt->expression);
     return {};
 }
 
-std::any Resolver::visitMutStmt(std::shared_ptr<MutStmt> stmt)
+Completion Resolver::visitMutStmt(MutStmt* stmt)
 {
     declare(stmt->name);
 
@@ -171,7 +173,7 @@ std::any Resolver::visitMutStmt(std::shared_ptr<MutStmt> stmt)
     return {};
 }
 
-std::any Resolver::visitIfStmt(std::shared_ptr<IfStmt> stmt)
+Completion Resolver::visitIfStmt(IfStmt* stmt)
 {
     resolve(stmt->condition);
     resolve(stmt->then_branch);
@@ -182,14 +184,14 @@ std::any Resolver::visitIfStmt(std::shared_ptr<IfStmt> stmt)
     return {};
 }
 
-std::any Resolver::visitWhileStmt(std::shared_ptr<WhileStmt> stmt)
+Completion Resolver::visitWhileStmt(WhileStmt* stmt)
 {
     resolve(stmt->condition);
     resolve(stmt->body);
     return {};
 }
 
-std::any Resolver::visitFunctionStmt(std::shared_ptr<FunctionStmt> stmt)
+Completion Resolver::visitFunctionStmt(FunctionStmt* stmt)
 {
     declare(stmt->name);
     define(stmt->name);
@@ -198,7 +200,7 @@ std::any Resolver::visitFunctionStmt(std::shared_ptr<FunctionStmt> stmt)
     return {};
 }
 
-std::any Resolver::visitReturnStmt(std::shared_ptr<ReturnStmt> stmt)
+Completion Resolver::visitReturnStmt(ReturnStmt* stmt)
 {
     if (current_func == FunctionType::NONE)
         Error::error(stmt->keyword, "Can't return from top-level code");
@@ -208,17 +210,21 @@ std::any Resolver::visitReturnStmt(std::shared_ptr<ReturnStmt> stmt)
         if (current_func == FunctionType::INITIALIZER)
             Error::error(stmt->keyword, "Can't return a value from an initializer");
         resolve(stmt->value);
+
+        // nothing is left to do in the caller once the call returns
+        if (auto call = dynamic_cast<CallExpr*>(stmt->value))
+            call->tail = current_func != FunctionType::INITIALIZER;
     }
 
     return {};
 }
 
-std::any Resolver::visitBreakStmt(std::shared_ptr<BreakStmt> stmt)
+Completion Resolver::visitBreakStmt(BreakStmt* stmt)
 {
     return {};
 }
 
-std::any Resolver::visitClassStmt(std::shared_ptr<ClassStmt> stmt)
+Completion Resolver::visitClassStmt(ClassStmt* stmt)
 {
     ClassType enclosing_class = current_class;
     current_class = ClassType::CLASS;
@@ -226,7 +232,7 @@ std::any Resolver::visitClassStmt(std::shared_ptr<ClassStmt> stmt)
     declare(stmt->name);
     define(stmt->name);
 
-    if (stmt->superclass != nullptr && stmt->name.lexeme == stmt->superclass->name.lexeme)
+    if (stmt->superclass != nullptr && stmt->name.lexeme() == stmt->superclass->name.lexeme())
         Error::error(stmt->superclass->name, "Classes can't inherit from themselves");
     
     if (stmt->superclass != nullptr)
@@ -238,21 +244,18 @@ std::any Resolver::visitClassStmt(std::shared_ptr<ClassStmt> stmt)
     if (stmt->superclass != nullptr)
     {
         begin_scope();
-        scopes.back()["super"] = true;
+        scopes.back()["super"] = ScopeVar{true, 0};
     }
 
-    begin_scope();
-    scopes.back()["this"] = true;
-    for (std::shared_ptr<FunctionStmt> method : stmt->methods)
+    for (FunctionStmt* method : stmt->methods)
     {
         FunctionType declaration = FunctionType::METHOD;
 
-        if (method->name.lexeme == "init")
+        if (method->name.lexeme() == "init")
             declaration = FunctionType::INITIALIZER;
 
         resolve_function(method->fn, declaration);
     }
-    end_scope();
 
     if (stmt->superclass != nullptr)
         end_scope(); // end superclass scope
@@ -262,9 +265,9 @@ std::any Resolver::visitClassStmt(std::shared_ptr<ClassStmt> stmt)
     return {};
 }
 
-std::any Resolver::visitImportStmt(std::shared_ptr<ImportStmt> stmt)
+Completion Resolver::visitImportStmt(ImportStmt* stmt)
 {
-    std::string target = std::any_cast<std::string>(stmt->target->value);
+    std::string target = stmt->target->value.as_string();
     bool is_core = false;
 
     if (target.find("core:") != 0)
@@ -290,42 +293,82 @@ std::any Resolver::visitImportStmt(std::shared_ptr<ImportStmt> stmt)
 }
 
 
-void Resolver::resolve(std::shared_ptr<Stmt> stmt)
+void Resolver::resolve(Stmt* stmt)
 {
     stmt->accept(*this);
 }
 
-void Resolver::resolve(std::shared_ptr<Expr> expr)
+void Resolver::resolve(Expr* expr)
 {
     expr->accept(*this);
 }
 
-void Resolver::resolve_function(std::shared_ptr<FunctionExpr> fn, FunctionType type)
+void Resolver::resolve_function(FunctionExpr* fn, FunctionType type)
 {
     FunctionType enclosing_func = current_func;
     current_func = type;
 
     begin_scope();
+    fn->captures.clear();
+    functions.push_back(FunctionScope{fn, static_cast<int>(scopes.size()) - 1});
+
+    // methods get the receiver as slot 0 of their own scope, so a call can pass it like an argument
+    if (type == FunctionType::METHOD || type == FunctionType::INITIALIZER)
+        scopes.back()["this"] = ScopeVar{true, 0};
+
     for (const Token& param : fn->parameters)
     {
         declare(param);
         define(param);
     }
     resolve(fn->body);
+    fn->slot_count = scopes.back().size();
     end_scope();
+    functions.pop_back();
 
     current_func = enclosing_func;
 }
 
-void Resolver::resolve_local(std::shared_ptr<Expr> expr, const Token& name)
+void Resolver::resolve_local(LocalSlot& local, std::string_view name)
 {
+    int scope = -1;
+
     for (int i = scopes.size() - 1; i >= 0; i--)
     {
-        if (scopes[i].find(name.lexeme) != scopes[i].end())
+        auto element = scopes[i].find(name);
+
+        if (element != scopes[i].end())
         {
-            interpreter.resolve(expr, scopes.size() - i - 1);
+            scope = i;
+            local.depth = scopes.size() - i - 1;
+            local.slot = element->second.slot;
         }
     }
+
+    // a variable of an outer function is a free variable of this one
+    if (scope >= 0 && !functions.empty() && scope < functions.back().scope)
+        local.capture = add_capture(functions.size() - 1, scope, local.slot);
+}
+
+int Resolver::add_capture(int function, int scope, int slot)
+{
+    // the variable is captured from the scopes around the function, or through the enclosing function
+    FunctionScope& current = functions[function];
+    Capture capture{true, current.scope - 1 - scope, slot, -1};
+
+    if (function > 0 && scope < functions[function - 1].scope)
+        capture = Capture{false, 0, 0, add_capture(function - 1, scope, slot)};
+
+    std::vector<Capture>& captures = current.fn->captures;
+
+    for (size_t i = 0; i < captures.size(); i++)
+    {
+        if (captures[i] == capture)
+            return i;
+    }
+
+    captures.push_back(capture);
+    return captures.size() - 1;
 }
 
 void Resolver::declare(const Token& name)
@@ -333,23 +376,29 @@ void Resolver::declare(const Token& name)
     if (scopes.empty())
         return;
     
-    std::map<std::string, bool>& scope = scopes.back();
+    std::map<std::string, ScopeVar, std::less<>>& scope = scopes.back();
 
-    if (scope.find(name.lexeme) != scope.end())
+    if (scope.find(name.lexeme()) != scope.end())
+    {
         Error::error(name, "Already a variable with this name in this scope");
-    scope[name.lexeme] = false;
+        return;
+    }
+
+    // slots are handed out in declaration order
+    int slot = scope.size();
+    scope[std::string(name.lexeme())] = ScopeVar{false, slot};
 }
 
 void Resolver::define(const Token& name)
 {
     if (scopes.empty())
         return;
-    scopes.back()[name.lexeme] = true;
+    scopes.back()[std::string(name.lexeme())].defined = true;
 }
 
 void Resolver::begin_scope()
 {
-    scopes.push_back(std::map<std::string, bool>{});
+    scopes.push_back(std::map<std::string, ScopeVar, std::less<>>{});
 }
 
 void Resolver::end_scope()
@@ -0,0 +1,37 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#include "shape.hpp"
+
+int Shape::find(const std::string& name) const
+{
+    // offset of the field in the instance, -1 if this shape doesn't have it
+    auto element = offsets.find(name);
+
+    if (element != offsets.end())
+        return element->second;
+
+    return -1;
+}
+
+Shape* Shape::add(const std::string& name)
+{
+    // the shape reached by adding a field, made once and shared afterwards
+    auto element = transitions.find(name);
+
+    if (element != transitions.end())
+        return element->second.get();
+
+    // made before it's linked, running out of memory leaves no empty transition behind
+    Ref<Shape> next = new Shape();
+    next->offsets = offsets;
+    next->offsets[name] = offsets.size();
+    return transitions.emplace(name, std::move(next)).first->second.get();
+}
+
+int Shape::size() const
+{
+    return offsets.size();
+}
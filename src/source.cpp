@@ -0,0 +1,63 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "source.hpp"
+
+// a deque never moves its elements, the text of a source stays where the tokens expect it
+std::deque<Source> Source::sources(1);
+std::vector<const char*> Source::texts{""};
+
+uint32_t Source::add_view(std::string_view text)
+{
+    sources.back().text = text;
+    texts.push_back(text.data());
+    return sources.size() - 1;
+}
+
+uint32_t Source::add(std::string text)
+{
+    sources.emplace_back();
+    sources.back().owned = std::move(text);
+    return add_view(sources.back().owned);
+}
+
+uint32_t Source::load(const std::string& path)
+{
+    int file = open(path.c_str(), O_RDONLY);
+
+    if (file < 0)
+        return add("");
+
+    struct stat info;
+    void* mapping = MAP_FAILED;
+
+    if (fstat(file, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+        mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+    if (mapping == MAP_FAILED)
+    {
+        // pipes and the like can't be mapped, read them whole
+        std::string text;
+        char buffer[1 << 16];
+        ssize_t count;
+
+        while ((count = read(file, buffer, sizeof(buffer))) > 0)
+            text.append(buffer, count);
+
+        close(file);
+        return add(std::move(text));
+    }
+
+    // never unmapped, sources live as long as the program
+    close(file);
+    madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+    sources.emplace_back();
+    return add_view(std::string_view(static_cast<const char*>(mapping), info.st_size));
+}
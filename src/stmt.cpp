@@ -5,99 +5,99 @@
 
 #include "stmt.hpp"
 
-BlockStmt::BlockStmt(std::vector<std::shared_ptr<Stmt>> statements)
+BlockStmt::BlockStmt(std::vector<Stmt*> statements)
     : statements(std::move(statements)) {}
 
-std::any BlockStmt::accept(StmtVisitor& visitor)
+Completion BlockStmt::accept(StmtVisitor& visitor)
 {
-    return visitor.visitBlockStmt(shared_from_this());
+    return visitor.visitBlockStmt(this);
 }
 
 
-ExpressionStmt::ExpressionStmt(std::shared_ptr<Expr> expression) 
-    : expression(std::move(expression)) {}
+ExpressionStmt::ExpressionStmt(Expr* expression) 
+    : expression(expression) {}
 
-std::any ExpressionStmt::accept(StmtVisitor& visitor)
+Completion ExpressionStmt::accept(StmtVisitor& visitor)
 {
-    return visitor.visitExpressionStmt(shared_from_this());
+    return visitor.visitExpressionStmt(this);
 }
 
 
-PrintStmt::PrintStmt(std::shared_ptr<Expr> expression) 
-    : expression(std::move(expression)) {}
+PrintStmt::PrintStmt(Expr* expression) 
+    : expression(expression) {}
 
-std::any PrintStmt::accept(StmtVisitor& visitor)
+Completion PrintStmt::accept(StmtVisitor& visitor)
 {
-    return visitor.visitPrintStmt(shared_from_this());
+    return visitor.visitPrintStmt(this);
 }
 
 
-MutStmt::MutStmt(Token name, std::shared_ptr<Expr> initializer) 
-    : name(std::move(name)), initializer(std::move(initializer)) {}
+MutStmt::MutStmt(Token name, Expr* initializer) 
+    : name(std::move(name)), initializer(initializer) {}
 
-std::any MutStmt::accept(StmtVisitor& visitor)
+Completion MutStmt::accept(StmtVisitor& visitor)
 {
-    return visitor.visitMutStmt(shared_from_this());
+    return visitor.visitMutStmt(this);
 }
 
 
-IfStmt::IfStmt(std::shared_ptr<Expr> condition, std::shared_ptr<Stmt> then_branch, std::shared_ptr<Stmt> else_branch)
-    : condition(std::move(condition)), then_branch(std::move(then_branch)), else_branch(std::move(else_branch)) {}
+IfStmt::IfStmt(Expr* condition, Stmt* then_branch, Stmt* else_branch)
+    : condition(condition), then_branch(then_branch), else_branch(else_branch) {}
 
-std::any IfStmt::accept(StmtVisitor& visitor)
+Completion IfStmt::accept(StmtVisitor& visitor)
 {
-    return visitor.visitIfStmt(shared_from_this());
+    return visitor.visitIfStmt(this);
 }
 
 
-WhileStmt::WhileStmt(std::shared_ptr<Expr> condition, std::shared_ptr<Stmt> body)
-    : condition(std::move(condition)), body(std::move(body)) {}
+WhileStmt::WhileStmt(Expr* condition, Stmt* body)
+    : condition(condition), body(body) {}
 
-std::any WhileStmt::accept(StmtVisitor& visitor)
+Completion WhileStmt::accept(StmtVisitor& visitor)
 {
-    return visitor.visitWhileStmt(shared_from_this());
+    return visitor.visitWhileStmt(this);
 }
 
 
-FunctionStmt::FunctionStmt(Token name, std::shared_ptr<FunctionExpr> fn)
-    : name{std::move(name)}, fn{std::move(fn)} {}
+FunctionStmt::FunctionStmt(Token name, FunctionExpr* fn)
+    : name{std::move(name)}, fn{fn} {}
 
-std::any FunctionStmt::accept(StmtVisitor& visitor)
+Completion FunctionStmt::accept(StmtVisitor& visitor)
 {
-    return visitor.visitFunctionStmt(shared_from_this());
+    return visitor.visitFunctionStmt(this);
 }
 
 
-ReturnStmt::ReturnStmt(Token keyword, std::shared_ptr<Expr> value)
-    : keyword{std::move(keyword)}, value{std::move(value)} {}
+ReturnStmt::ReturnStmt(Token keyword, Expr* value)
+    : keyword{std::move(keyword)}, value{value} {}
 
-std::any ReturnStmt::accept(StmtVisitor& visitor)
+Completion ReturnStmt::accept(StmtVisitor& visitor)
 {
-    return visitor.visitReturnStmt(shared_from_this());
+    return visitor.visitReturnStmt(this);
 }
 
 
 BreakStmt::BreakStmt() {}
 
-std::any BreakStmt::accept(StmtVisitor& visitor)
+Completion BreakStmt::accept(StmtVisitor& visitor)
 {
-    return visitor.visitBreakStmt(shared_from_this());
+    return visitor.visitBreakStmt(this);
 }
 
 
-ClassStmt::ClassStmt(Token name, std::shared_ptr<MutExpr> superclass, std::vector<std::shared_ptr<FunctionStmt>> methods)
-    : name(std::move(name)), superclass(std::move(superclass)), methods(std::move(methods)) {}
+ClassStmt::ClassStmt(Token name, MutExpr* superclass, std::vector<FunctionStmt*> methods)
+    : name(std::move(name)), superclass(superclass), methods(std::move(methods)) {}
 
-std::any ClassStmt::accept(StmtVisitor& visitor)
+Completion ClassStmt::accept(StmtVisitor& visitor)
 {
-    return visitor.visitClassStmt(shared_from_this());
+    return visitor.visitClassStmt(this);
 }
 
 
-ImportStmt::ImportStmt(Token keyword, std::shared_ptr<LiteralExpr> target)
-    : keyword(std::move(keyword)), target(std::move(target)) {}
+ImportStmt::ImportStmt(Token keyword, LiteralExpr* target)
+    : keyword(std::move(keyword)), target(target) {}
 
-std::any ImportStmt::accept(StmtVisitor& visitor)
+Completion ImportStmt::accept(StmtVisitor& visitor)
 {
-    return visitor.visitImportStmt(shared_from_this());
+    return visitor.visitImportStmt(this);
 }
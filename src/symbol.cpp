@@ -0,0 +1,30 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#include "symbol.hpp"
+
+std::unordered_map<std::string, Symbol>& SymbolTable::symbols()
+{
+    // made on first use, classes can be built while other statics are still being set up
+    static std::unordered_map<std::string, Symbol> table;
+    return table;
+}
+
+Symbol SymbolTable::intern(const std::string& name)
+{
+    // a new name takes the next free symbol
+    return symbols().try_emplace(name, symbols().size()).first->second;
+}
+
+Symbol SymbolTable::find(const std::string& name)
+{
+    // -1 if the name was never interned, nothing can be stored under it then
+    auto element = symbols().find(name);
+
+    if (element != symbols().end())
+        return element->second;
+
+    return -1;
+}
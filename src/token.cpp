@@ -5,8 +5,11 @@
 
 #include "token.hpp"
 
-Token::Token(TokenType type, std::string lexeme, std::any literal, int line)
-    : type(type), lexeme(lexeme), literal(literal), line(line) {}
+Token::Token(TokenType type, int line)
+    : type(type), column(0), line(line), offset(0), length(0), source(0) {}
+
+Token::Token(TokenType type, uint32_t source, uint32_t offset, uint32_t length, int line, uint16_t column)
+    : type(type), column(column), line(line), offset(offset), length(length), source(source) {}
 
 std::string Token::to_string() const
 {
@@ -15,13 +18,13 @@ std::string Token::to_string() const
     switch (type)
     {
         case (IDENTIFIER):
-            literal_text = lexeme;
+            literal_text = lexeme();
             break;
         case (STRING):
-            literal_text = std::any_cast<std::string>(literal);
+            literal_text = string();
             break;
         case (NUMBER):
-            literal_text = std::to_string(std::any_cast<double>(literal));
+            literal_text = std::to_string(number());
             break;
         case (TRUE):
             literal_text = "true";
@@ -33,7 +36,7 @@ std::string Token::to_string() const
             literal_text = "nil";
     }
 
-    return "Type: " + ::token_to_string(type) + " | Lexeme: " + lexeme + " | Literal: " + literal_text;
+    return "Type: " + ::token_to_string(type) + " | Lexeme: " + std::string(lexeme()) + " | Literal: " + literal_text;
 } 
 
 std::string token_to_string(TokenType type)
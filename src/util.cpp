@@ -3,41 +3,82 @@
 // Licensed under Apache License v2.0
 //------------------------------------//
 
+#include <iomanip>
+
 #include "util.hpp"
 
-void run(const std::string& source, Interpreter& interpreter, std::string base_dir)
+using Clock = std::chrono::steady_clock;
+
+double PhaseTimes::load = 0;
+double PhaseTimes::lex = 0;
+double PhaseTimes::parse = 0;
+double PhaseTimes::resolve = 0;
+
+// adds the time since start to phase, the next phase starts now
+static void lap(double& phase, Clock::time_point& start)
+{
+    Clock::time_point now = Clock::now();
+    phase += std::chrono::duration<double, std::milli>(now - start).count();
+    start = now;
+}
+
+void PhaseTimes::print()
 {
+    std::cerr << "phase times\n" << std::fixed << std::setprecision(3)
+              << "  load: " << load << " ms\n"
+              << "  lex: " << lex << " ms\n"
+              << "  parse: " << parse << " ms\n"
+              << "  resolve: " << resolve << " ms\n";
+}
+
+uint32_t load_file(const std::string& path)
+{
+    // the file is mapped and lexed in place, the tokens point into it for the rest of the program
+    Clock::time_point start = Clock::now();
+    uint32_t source = Source::load(path);
+    lap(PhaseTimes::load, start);
+    return source;
+}
+
+std::unique_ptr<Ast> parse(uint32_t source, std::string base_dir)
+{
+    // lex, parse and resolve, check Error::has_error before using the result
+    Clock::time_point start = Clock::now();
     Lexer lexer{source};
     std::vector<Token> tokens = lexer.scan_tokens();
+    lap(PhaseTimes::lex, start);
 
-    Parser parser{tokens};
-    std::vector<std::shared_ptr<Stmt>> statements = parser.parse();
+    auto ast = std::make_unique<Ast>();
+    Parser parser{tokens, *ast};
+    parser.parse();
+    lap(PhaseTimes::parse, start);
 
     if (Error::has_error) // syntax error
-        return;
+        return ast;
 
-    Resolver resolver{interpreter, base_dir};
-    resolver.resolve(statements);
+    Resolver resolver{base_dir};
+    resolver.resolve(ast->statements);
+    lap(PhaseTimes::resolve, start);
+
+    return ast;
+}
 
-    if (Error::has_error) // resolution error
+void run(uint32_t source, Engine& engine, std::string base_dir)
+{
+    std::unique_ptr<Ast> ast = parse(source, base_dir);
+
+    if (Error::has_error) // syntax or resolution error
         return;
 
-    interpreter.interpret(statements);
+    engine.interpret(std::move(ast));
 
     // std::cout << AstPrinter{}.print(expression) + "\n";
 }
 
-void run_file(const std::string& path, Interpreter& interpreter)
+void run_file(const std::string& path, Engine& engine)
 {
     // std::cout << "Executing file: " + path + "\n";
-    std::ifstream file{path};
-    std::string line;
-    std::string file_content;
-
-    while (std::getline(file, line))
-        file_content += line + "\n";
-
-    run(file_content, interpreter, path);
+    run(load_file(path), engine, path);
     
     if (Error::has_error)
         exit(2);
@@ -46,7 +87,7 @@ void run_file(const std::string& path, Interpreter& interpreter)
         exit(3);
 }
 
-void run_prompt(Interpreter& interpreter)
+void run_prompt(Engine& engine)
 {
     std::string text;
     std::string base_dir = fs::current_path().string();
@@ -60,11 +101,12 @@ void run_prompt(Interpreter& interpreter)
             Error::has_error = false;
             
             // run(text);
-            Lexer lexer{text};
+            Lexer lexer{Source::add(text)};
             std::vector<Token> tokens = lexer.scan_tokens();
 
-            Parser parser{tokens};
-            std::any syntax = parser.parse_repl();
+            auto ast = std::make_unique<Ast>();
+            Parser parser{tokens, *ast};
+            parser.parse_repl();
 
             if (Error::has_error) // syntax error
             {
@@ -72,16 +114,16 @@ void run_prompt(Interpreter& interpreter)
                 continue;
             }
             
-            Resolver resolver{interpreter, base_dir};
-            resolver.resolve(std::any_cast<std::vector<std::shared_ptr<Stmt>>>(syntax));
+            Resolver resolver{base_dir};
+            resolver.resolve(ast->statements);
 
-            if (syntax.type() == typeid(std::vector<std::shared_ptr<Stmt>>))
+            if (ast->expression == nullptr)
             {
-                interpreter.interpret(std::any_cast<std::vector<std::shared_ptr<Stmt>>>(syntax));
+                engine.interpret(std::move(ast));
             }
-            else if (syntax.type() == typeid(std::shared_ptr<Expr>))
+            else
             {
-                std::string result = interpreter.interpret(std::any_cast<std::shared_ptr<Expr>>(syntax));
+                std::string result = engine.interpret_expression(std::move(ast));
 
                 if (result != "")
                     std::cout << result + "\n";
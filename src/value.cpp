@@ -0,0 +1,160 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#include "value.hpp"
+#include "list.hpp"
+#include "instance.hpp"
+#include "function.hpp"
+#include "class.hpp"
+#include "closure.hpp"
+#include "closure_compiler.hpp"
+#include "heap.hpp"
+
+// the characters count towards the heap, the string itself comes from Object's allocator
+NblString::NblString(std::string chars)
+    : chars(std::move(chars))
+{
+    Heap::charge_current(this->chars.capacity());
+}
+
+NblString::~NblString()
+{
+    Heap::refund_current(chars.capacity());
+}
+
+Value::Value(ValueType type, Object* object)
+    : type(type)
+{
+    as.object = object;
+    retain();
+}
+
+Value::Value(const char* chars)
+    : Value(ValueType::STRING, new NblString(chars)) {}
+
+Value::Value(std::string chars)
+    : Value(ValueType::STRING, new NblString(std::move(chars))) {}
+
+Value::Value(NblString* string)
+    : Value(ValueType::STRING, string) {}
+
+Value::Value(ListType* list)
+    : Value(ValueType::LIST, list) {}
+
+Value::Value(NblInstance* instance)
+    : Value(ValueType::INSTANCE, instance) {}
+
+Value::Value(NblFunction* function)
+    : Value(ValueType::FUNCTION, function) {}
+
+Value::Value(NblClass* klass)
+    : Value(ValueType::CLASS, klass) {}
+
+Value::Value(NblNative* native)
+    : Value(ValueType::NATIVE, native) {}
+
+Value::Value(NblClosure* closure)
+    : Value(ValueType::CLOSURE, closure) {}
+
+Value::Value(NblBoundMethod* method)
+    : Value(ValueType::BOUND_METHOD, method) {}
+
+Value::Value(NblCompiledFunction* function)
+    : Value(ValueType::COMPILED_FUNCTION, function) {}
+
+bool is_truthy(const Value& obj)
+{
+    // handle boolean values
+    if (obj.is_nil())
+        return false;
+    
+    if (obj.is_bool())
+        return obj.as_bool();
+    
+    return true;
+}
+
+bool is_equal(const Value& obj1, const Value& obj2)
+{
+    // handle equality
+    if (obj1.get_type() != obj2.get_type())
+        return false;
+
+    switch (obj1.get_type())
+    {
+        case ValueType::NIL: return true;
+        case ValueType::BOOL: return obj1.as_bool() == obj2.as_bool();
+        case ValueType::NUMBER: return obj1.as_number() == obj2.as_number();
+        case ValueType::STRING: return obj1.as_string() == obj2.as_string();
+        default: return false;
+    }
+}
+
+std::string int_or_double(double number)
+{
+    // checking for weather the object is an int or a double
+    std::string text;
+
+    if (number == static_cast<int>(number))
+    {
+        // is an integer
+        text = std::to_string(static_cast<int>(number));
+    }
+    else
+    {
+        // is a double
+        text = std::to_string(number);
+
+        if (text[text.length() - 2] == '.' && text[text.length() - 1] == '0')
+            text = text.substr(0, text.length() - 2);
+    }
+
+    return text;
+}
+
+std::string stringify(const Value& obj)
+{
+    // stringifying each types
+    switch (obj.get_type())
+    {
+        case ValueType::NIL:
+            return "nil";
+        case ValueType::NUMBER:
+            return int_or_double(obj.as_number());
+        case ValueType::STRING:
+            return obj.as_string();
+        case ValueType::BOOL:
+            return obj.as_bool() ? "true" : "false";
+        case ValueType::FUNCTION:
+        case ValueType::CLASS:
+        case ValueType::NATIVE:
+        case ValueType::CLOSURE:
+        case ValueType::BOUND_METHOD:
+        case ValueType::COMPILED_FUNCTION:
+            return obj.as_object<NblCallable>()->to_string();
+        case ValueType::INSTANCE:
+            return obj.as_object<NblInstance>()->to_string();
+        case ValueType::LIST:
+        {
+            std::string result = "[";
+            const HeapVector<Value>& elements = obj.as_object<ListType>()->elements;
+
+            for (auto i = elements.begin(); i != elements.end(); i++)
+            {
+                auto next = i + 1;
+
+                result.append(stringify(*i));
+
+                if (next != elements.end())
+                    result.append(", ");
+            }
+
+            result.append("]");
+            return result;
+        }
+    }
+
+    return "Error in stringify: Invalid object type";
+}
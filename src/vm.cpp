@@ -0,0 +1,945 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+#include "vm.hpp"
+#include "util.hpp"
+#include "budget.hpp"
+#include "depth.hpp"
+
+VM::VM(Heap& heap)
+    : Engine(heap)
+{
+    // native functions
+    for (auto& [name, native] : make_natives())
+        define_native(name, native);
+
+    leave_heap();
+}
+
+VM::~VM()
+{
+    // the members free their objects after this, in the heap they were made in
+    enter_heap();
+}
+
+void VM::interpret(std::unique_ptr<Ast> module)
+{
+    Heap::Use use(&heap);
+
+    // compiling makes objects too, running out of memory there is reported like any runtime error
+    try
+    {
+        // the bytecode doesn't point into the tree, it goes away before the program runs
+        Compiler compiler{*this};
+        Ref<NblPrototype> script = compiler.compile(module->statements);
+        module.reset();
+
+        if (Error::has_error) // compile error
+            return;
+
+        execute(script);
+    }
+    catch (const RuntimeError& error)
+    {
+        reset();
+        Error::runtime_error(error);
+    }
+}
+
+std::string VM::interpret_expression(std::unique_ptr<Ast> module)
+{
+    Heap::Use use(&heap);
+
+    try
+    {
+        Compiler compiler{*this};
+        Ref<NblPrototype> script = compiler.compile_expression(module->expression);
+        module.reset();
+
+        if (Error::has_error)
+            return "";
+
+        return stringify(execute(script));
+    }
+    catch (const RuntimeError& error)
+    {
+        reset();
+        Error::runtime_error(error);
+        return "";
+    }
+}
+
+int VM::global_slot(const std::string& name)
+{
+    auto element = global_slots.find(name);
+
+    if (element != global_slots.end())
+        return element->second;
+
+    int slot = globals.size();
+    globals.push_back(Global{name, nullptr, false});
+    global_slots[name] = slot;
+
+    return slot;
+}
+
+Value VM::execute(Ref<NblPrototype> script)
+{
+    // the script is called like a function with no arguments
+    NblClosure* closure = new NblClosure(std::move(script));
+    push(closure);
+    push_frame(closure, stack_top - 1, nullptr);
+
+    return run();
+}
+
+Value VM::run()
+{
+    CallFrame* frame;
+    const uint8_t* ip;
+    Value* slots;
+    const Value* constants;
+    InlineCache* caches;
+
+    // cache the current frame in locals, reloaded after every call and return
+    auto load_frame = [&]()
+    {
+        frame = &frames[frame_count - 1];
+        ip = frame->ip;
+        slots = frame->slots;
+        constants = frame->closure->prototype->chunk.constants.data();
+        caches = frame->closure->prototype->chunk.caches.data();
+    };
+
+    auto read_byte = [&]() { return *ip++; };
+    auto read_short = [&]()
+    {
+        ip += 2;
+        return static_cast<uint16_t>(ip[-2] << 8 | ip[-1]);
+    };
+    auto read_long = [&]()
+    {
+        ip += 3;
+        return ip[-3] << 16 | ip[-2] << 8 | ip[-1];
+    };
+
+    // index operands, read by the instruction or by a LONG prefix before jumping to its label
+    int operand;
+    int second;
+    bool wide = false; // the upvalue indices of CLOSURE are u24 too
+
+    load_frame();
+
+    while (true)
+    {
+        switch (static_cast<OpCode>(read_byte()))
+        {
+            case OpCode::LONG:
+            {
+                // rare, a function with more locals, constants or property sites than the short operands reach
+                OpCode op = static_cast<OpCode>(read_byte());
+                operand = read_long();
+
+                switch (op)
+                {
+                    case OpCode::CONSTANT: goto constant;
+                    case OpCode::GET_LOCAL: goto get_local;
+                    case OpCode::SET_LOCAL: goto set_local;
+                    case OpCode::GET_UPVALUE: goto get_upvalue;
+                    case OpCode::SET_UPVALUE: goto set_upvalue;
+                    case OpCode::GET_GLOBAL: goto get_global;
+                    case OpCode::DEFINE_GLOBAL: goto define_global;
+                    case OpCode::SET_GLOBAL: goto set_global;
+                    case OpCode::GET_PROPERTY: second = read_long(); goto get_property;
+                    case OpCode::LOAD_METHOD: second = read_long(); goto load_method;
+                    case OpCode::SET_PROPERTY: second = read_long(); goto set_property;
+                    case OpCode::GET_SUPER: goto get_super;
+                    case OpCode::CLOSURE: wide = true; goto closure;
+                    case OpCode::CLASS: goto make_class;
+                    case OpCode::METHOD: goto method;
+                    case OpCode::IMPORT: goto import;
+                    default: break; // the compiler never prefixes anything else
+                }
+                break;
+            }
+
+            case OpCode::CONSTANT:
+                operand = read_short();
+            constant:
+                push(constants[operand]);
+                break;
+            case OpCode::NIL:
+                push(nullptr);
+                break;
+            case OpCode::TRUE:
+                push(true);
+                break;
+            case OpCode::FALSE:
+                push(false);
+                break;
+            case OpCode::POP:
+                discard();
+                break;
+
+            case OpCode::GET_LOCAL:
+                operand = read_byte();
+            get_local:
+                push(slots[operand]);
+                break;
+            case OpCode::SET_LOCAL:
+                operand = read_byte();
+            set_local:
+                slots[operand] = stack_top[-1];
+                break;
+            case OpCode::GET_UPVALUE:
+                operand = read_byte();
+            get_upvalue:
+                push(*frame->closure->upvalues[operand]->location);
+                break;
+            case OpCode::SET_UPVALUE:
+                operand = read_byte();
+            set_upvalue:
+                *frame->closure->upvalues[operand]->location = stack_top[-1];
+                break;
+
+            case OpCode::GET_GLOBAL:
+                operand = read_short();
+            get_global:
+            {
+                Global& global = globals[operand];
+
+                if (!global.defined)
+                    runtime_error(ip, "Undefined variable: '" + global.name + "'");
+
+                push(global.value);
+                break;
+            }
+            case OpCode::DEFINE_GLOBAL:
+                operand = read_short();
+            define_global:
+            {
+                Global& global = globals[operand];
+                global.value = pop();
+                global.defined = true;
+                break;
+            }
+            case OpCode::SET_GLOBAL:
+                operand = read_short();
+            set_global:
+            {
+                Global& global = globals[operand];
+
+                if (!global.defined)
+                    runtime_error(ip, "Undefined variable: '" + global.name + "'");
+
+                global.value = stack_top[-1];
+                break;
+            }
+
+            case OpCode::GET_PROPERTY:
+                operand = read_short();
+                second = read_short();
+            get_property:
+            {
+                const std::string& name = constants[operand].as_string();
+                InlineCache& cache = caches[second];
+                Value& object = stack_top[-1];
+
+                if (!object.is_instance())
+                    runtime_error(ip, "Only instances have properties");
+
+                NblInstance* instance = object.as_object<NblInstance>();
+                const CacheEntry& entry = cache.get(instance, name);
+
+                if (entry.offset >= 0)
+                {
+                    // copy before the slot lets go of the instance
+                    Value value = instance->field_at(entry.offset);
+                    object = std::move(value);
+                    break;
+                }
+
+                if (entry.method == nullptr)
+                    runtime_error(ip, "Undefined property '" + name + "'");
+
+                object = new NblBoundMethod(object, static_cast<NblClosure*>(entry.method));
+                break;
+            }
+            case OpCode::LOAD_METHOD:
+                operand = read_short();
+                second = read_short();
+            load_method:
+            {
+                // leaves the method under its receiver, or nil under the value of a field
+                const std::string& name = constants[operand].as_string();
+                InlineCache& cache = caches[second];
+                Value& object = stack_top[-1];
+
+                if (!object.is_instance())
+                    runtime_error(ip, "Only instances have properties");
+
+                NblInstance* instance = object.as_object<NblInstance>();
+                const CacheEntry& entry = cache.get(instance, name);
+
+                if (entry.offset >= 0)
+                {
+                    Value value = instance->field_at(entry.offset);
+                    object = nullptr;
+                    push(std::move(value));
+                    break;
+                }
+
+                if (entry.method == nullptr)
+                    runtime_error(ip, "Undefined property '" + name + "'");
+
+                Value receiver = std::move(object);
+                object = static_cast<NblClosure*>(entry.method);
+                push(std::move(receiver));
+                break;
+            }
+            case OpCode::SET_PROPERTY:
+                operand = read_short();
+                second = read_short();
+            set_property:
+            {
+                const std::string& name = constants[operand].as_string();
+                InlineCache& cache = caches[second];
+                Value& object = stack_top[-2]; // an instance, CHECK_INSTANCE ran before the value
+
+                cache.set(object.as_object<NblInstance>(), name, stack_top[-1]);
+
+                Value value = pop();
+                stack_top[-1] = std::move(value);
+                break;
+            }
+            case OpCode::GET_SUPER:
+                operand = read_short();
+            get_super:
+            {
+                // stack holds the receiver then the superclass
+                const std::string& name = constants[operand].as_string();
+                NblCallable* method = stack_top[-1].as_object<NblClass>()->find_method(name);
+
+                if (method == nullptr)
+                    runtime_error(ip, "Undefined property '" + name + "'");
+
+                Value bound = new NblBoundMethod(stack_top[-2], static_cast<NblClosure*>(method));
+                discard();
+                stack_top[-1] = std::move(bound);
+                break;
+            }
+
+            case OpCode::EQUAL:
+            {
+                bool equal = is_equal(stack_top[-2], stack_top[-1]);
+                discard();
+                stack_top[-1] = equal;
+                break;
+            }
+            case OpCode::NOT_EQUAL:
+            {
+                bool equal = is_equal(stack_top[-2], stack_top[-1]);
+                discard();
+                stack_top[-1] = !equal;
+                break;
+            }
+            case OpCode::GREATER:
+            case OpCode::GREATER_EQUAL:
+            case OpCode::LESS:
+            case OpCode::LESS_EQUAL:
+            {
+                const Value& left = stack_top[-2];
+                const Value& right = stack_top[-1];
+
+                if (!left.is_number() || !right.is_number())
+                    runtime_error(ip, "Operands must be numbers");
+
+                double a = left.as_number();
+                double b = right.as_number();
+                bool result;
+
+                switch (static_cast<OpCode>(ip[-1]))
+                {
+                    case OpCode::GREATER: result = a > b; break;
+                    case OpCode::GREATER_EQUAL: result = a >= b; break;
+                    case OpCode::LESS: result = a < b; break;
+                    default: result = a <= b; break;
+                }
+
+                // both operands are numbers, nothing to release
+                --stack_top;
+                stack_top[-1] = result;
+                break;
+            }
+            case OpCode::ADD:
+            {
+                Value& left = stack_top[-2];
+                const Value& right = stack_top[-1];
+
+                if (left.is_number() && right.is_number())
+                {
+                    left = left.as_number() + right.as_number();
+                    --stack_top;
+                    break;
+                }
+
+                Value result;
+
+                if (left.is_string() && right.is_string())
+                    result = left.as_string() + right.as_string();
+                else if (left.is_string() && right.is_number())
+                    result = left.as_string() + int_or_double(right.as_number());
+                else if (left.is_number() && right.is_string())
+                    result = int_or_double(left.as_number()) + right.as_string();
+                else
+                    runtime_error(ip, "Operands must be 2 numbers, 2 strings, or 1 number and 1 string");
+
+                discard();
+                stack_top[-1] = std::move(result);
+                break;
+            }
+            case OpCode::SUBTRACT:
+            case OpCode::MULTIPLY:
+            case OpCode::DIVIDE:
+            case OpCode::MODULO:
+            {
+                Value& left = stack_top[-2];
+                const Value& right = stack_top[-1];
+
+                // anything but two numbers is nil, like the tree-walker
+                if (!left.is_number() || !right.is_number())
+                {
+                    discard();
+                    stack_top[-1] = nullptr;
+                    break;
+                }
+
+                double a = left.as_number();
+                double b = right.as_number();
+
+                switch (static_cast<OpCode>(ip[-1]))
+                {
+                    case OpCode::SUBTRACT: left = a - b; break;
+                    case OpCode::MULTIPLY: left = a * b; break;
+                    case OpCode::DIVIDE: left = a / b; break;
+                    default: left = fmod(a, b); break;
+                }
+
+                --stack_top;
+                break;
+            }
+            case OpCode::POWER:
+            {
+                Value& left = stack_top[-2];
+                const Value& right = stack_top[-1];
+
+                if (!left.is_number() || !right.is_number())
+                    runtime_error(ip, "Operands must be numbers");
+
+                left = pow(left.as_number(), right.as_number());
+                --stack_top;
+                break;
+            }
+            case OpCode::NOT:
+                stack_top[-1] = !is_truthy(stack_top[-1]);
+                break;
+            case OpCode::NEGATE:
+                if (!stack_top[-1].is_number())
+                    runtime_error(ip, "Operand must be a number");
+
+                stack_top[-1] = -stack_top[-1].as_number();
+                break;
+
+            case OpCode::PRINT:
+                std::cout << stringify(stack_top[-1]) + "\n";
+                discard();
+                break;
+
+            case OpCode::JUMP:
+            {
+                int offset = read_long();
+                ip += offset;
+                break;
+            }
+            case OpCode::JUMP_IF_FALSE:
+            {
+                int offset = read_long();
+
+                if (!is_truthy(stack_top[-1]))
+                    ip += offset;
+                break;
+            }
+            case OpCode::JUMP_IF_TRUE:
+            {
+                int offset = read_long();
+
+                if (is_truthy(stack_top[-1]))
+                    ip += offset;
+                break;
+            }
+            case OpCode::POP_JUMP_IF_FALSE:
+            {
+                int offset = read_long();
+
+                if (!is_truthy(stack_top[-1]))
+                    ip += offset;
+
+                discard();
+                break;
+            }
+            case OpCode::LOOP:
+            {
+                int offset = read_long();
+                ip -= offset;
+                budget.tick();
+                break;
+            }
+
+            case OpCode::CALL:
+            {
+                int argc = read_byte();
+                frame->ip = ip;
+                call_value(argc, ip);
+                load_frame();
+                break;
+            }
+            case OpCode::CALL_METHOD:
+            {
+                int argc = read_byte();
+                frame->ip = ip;
+
+                // drop what LOAD_METHOD found so the receiver lands in the callee slot
+                Value* base = stack_top - argc - 2;
+                Value method = std::move(*base);
+                std::move(base + 1, stack_top, base);
+                pop();
+
+                if (method.is_nil())
+                    call_value(argc, ip);
+                else
+                    call_closure(method.as_object<NblClosure>(), argc, ip);
+
+                load_frame();
+                break;
+            }
+            case OpCode::TAIL_CALL:
+            {
+                int argc = read_byte();
+                frame->ip = ip;
+                tail_call(nullptr, argc, ip);
+                load_frame();
+                break;
+            }
+            case OpCode::TAIL_CALL_METHOD:
+            {
+                int argc = read_byte();
+                frame->ip = ip;
+
+                Value* base = stack_top - argc - 2;
+                Value method = std::move(*base);
+                std::move(base + 1, stack_top, base);
+                pop();
+
+                tail_call(std::move(method), argc, ip);
+                load_frame();
+                break;
+            }
+            case OpCode::CLOSURE:
+                operand = read_short();
+            closure:
+            {
+                NblPrototype* prototype = frame->closure->prototype->chunk.prototypes[operand].get();
+                NblClosure* closure = new NblClosure(prototype);
+                push(closure);
+
+                for (int i = 0; i < prototype->upvalue_count; i++)
+                {
+                    bool is_local = read_byte();
+                    int index = wide ? read_long() : read_byte();
+
+                    if (is_local)
+                        closure->upvalues[i] = capture_upvalue(slots + index);
+                    else
+                        closure->upvalues[i] = frame->closure->upvalues[index];
+                }
+
+                wide = false;
+                break;
+            }
+            case OpCode::CLOSE_UPVALUE:
+                close_upvalues(stack_top - 1);
+                discard();
+                break;
+            case OpCode::RETURN:
+            {
+                Value result = pop();
+                close_upvalues(slots);
+
+                // release the callee, the arguments and the locals
+                while (stack_top > slots)
+                    discard();
+
+                if (--frame_count == 0)
+                    return result;
+
+                push(std::move(result));
+                load_frame();
+                break;
+            }
+
+            case OpCode::CLASS:
+                operand = read_short();
+            make_class:
+            {
+                const std::string& name = constants[operand].as_string();
+                bool has_superclass = read_byte();
+                Ref<NblClass> superclass = nullptr;
+
+                if (has_superclass)
+                {
+                    if (!stack_top[-1].is_class())
+                        runtime_error(ip, "Superclass must be a class");
+
+                    superclass = stack_top[-1].as_object<NblClass>();
+                }
+
+                push(new NblClass(name, superclass, {}));
+                break;
+            }
+            case OpCode::METHOD:
+                operand = read_short();
+            method:
+            {
+                const std::string& name = constants[operand].as_string();
+                Value method = pop();
+                stack_top[-1].as_object<NblClass>()->add_method(name, method.as_object<NblClosure>());
+                break;
+            }
+
+            case OpCode::LIST:
+            {
+                int count = read_byte();
+                Ref<ListType> list = new ListType();
+
+                list->elements.assign(std::make_move_iterator(stack_top - count), std::make_move_iterator(stack_top));
+                stack_top -= count;
+                push(list);
+                break;
+            }
+            case OpCode::GET_INDEX:
+            {
+                const Value& name = stack_top[-2];
+                const Value& index = stack_top[-1];
+
+                if (!name.is_list())
+                    runtime_error(ip, "Only lists can be subscripted");
+
+                if (!index.is_number())
+                    runtime_error(ip, "Index should be of type int");
+
+                ListType* list = name.as_object<ListType>();
+                int casted_index = index.as_number();
+                Value element;
+
+                if (casted_index < list->get_length() && casted_index >= 0)
+                    element = list->elements[casted_index];
+
+                --stack_top; // the index is a number
+                stack_top[-1] = std::move(element);
+                break;
+            }
+            case OpCode::SET_INDEX:
+            {
+                // a list and a number, CHECK_SUBSCRIPT ran before the value
+                const Value& name = stack_top[-3];
+                const Value& index = stack_top[-2];
+
+                if (!name.as_object<ListType>()->set_element_at(index.as_number(), stack_top[-1]))
+                    runtime_error(ip, "Index out of range");
+
+                Value value = pop();
+                --stack_top; // the index is a number
+                stack_top[-1] = std::move(value);
+                break;
+            }
+
+            case OpCode::CHECK_INSTANCE:
+                if (!stack_top[-1].is_instance())
+                    runtime_error(ip, "Only instances have fields");
+                break;
+            case OpCode::CHECK_SUBSCRIPT:
+                if (!stack_top[-2].is_list())
+                    runtime_error(ip, "Only lists can be subscripted");
+
+                if (!stack_top[-1].is_number())
+                    runtime_error(ip, "Index should be of type int");
+                break;
+
+            case OpCode::IMPORT:
+                operand = read_short();
+            import:
+            {
+                const std::string& path = constants[operand].as_string();
+                frame->ip = ip;
+                import_file(path, ip);
+                load_frame();
+                break;
+            }
+        }
+    }
+}
+
+void VM::call_value(int argc, const uint8_t* ip)
+{
+    Value& callee = stack_top[-1 - argc];
+
+    switch (callee.get_type())
+    {
+        case ValueType::CLOSURE:
+            call_closure(callee.as_object<NblClosure>(), argc, ip);
+            return;
+
+        case ValueType::BOUND_METHOD:
+        {
+            // the receiver takes the callee's slot and becomes 'this'
+            NblBoundMethod* bound = callee.as_object<NblBoundMethod>();
+            Ref<NblClosure> method = bound->method;
+            Value receiver = bound->receiver;
+
+            callee = std::move(receiver);
+            call_closure(method.get(), argc, ip);
+            return;
+        }
+
+        case ValueType::CLASS:
+        {
+            NblClass* klass = callee.as_object<NblClass>();
+            NblCallable* initializer = klass->initializer();
+
+            if (argc != klass->arity())
+                runtime_error(ip, "Expected " + std::to_string(klass->arity()) + " arguments but got " + std::to_string(argc));
+
+            callee = new NblInstance(klass);
+
+            if (initializer != nullptr)
+                call_closure(static_cast<NblClosure*>(initializer), argc, ip);
+            return;
+        }
+
+        case ValueType::NATIVE:
+        {
+            NblNative* native = callee.as_object<NblNative>();
+
+            if (!native->accepts(argc))
+                runtime_error(ip, "Expected " + std::to_string(native->arity()) + " arguments but got " + std::to_string(argc));
+
+            std::vector<Value> arguments(std::make_move_iterator(stack_top - argc), std::make_move_iterator(stack_top));
+            stack_top -= argc;
+
+            Value result = native->call(call_site(ip), std::move(arguments));
+            stack_top[-1] = std::move(result);
+            return;
+        }
+
+        default:
+            runtime_error(ip, "Can only call functions");
+    }
+}
+
+void VM::call_closure(NblClosure* closure, int argc, const uint8_t* ip)
+{
+    NblPrototype* prototype = closure->prototype.get();
+
+    if (argc != prototype->arity)
+        runtime_error(ip, "Expected " + std::to_string(prototype->arity) + " arguments but got " + std::to_string(argc));
+
+    push_frame(closure, stack_top - argc - 1, ip);
+    budget.tick();
+}
+
+void VM::push_frame(NblClosure* closure, Value* slots, const uint8_t* ip)
+{
+    // the script's own frame doesn't count as a call
+    if (frame_count > CallDepth::limit())
+        runtime_error(ip, "Stack overflow");
+
+    if (frame_count == frames_size)
+    {
+        std::unique_ptr<CallFrame[]> grown{new CallFrame[2 * frames_size]};
+        std::copy(frames.get(), frames.get() + frame_count, grown.get());
+        frames = std::move(grown);
+        frames_size *= 2;
+    }
+
+    NblPrototype* prototype = closure->prototype.get();
+    size_t base = slots - stack.get();
+
+    if (base + prototype->max_stack > stack_size)
+        grow_stack(base + prototype->max_stack);
+
+    frames[frame_count++] = CallFrame{closure, prototype->chunk.code.data(), stack.get() + base};
+}
+
+void VM::grow_stack(size_t size)
+{
+    // the values move to a bigger array, the frames and open upvalues pointing into the old one follow
+    size_t grown_size = stack_size;
+
+    while (grown_size < size)
+        grown_size *= 2;
+
+    std::unique_ptr<Value[]> grown{new Value[grown_size]};
+    Value* old = stack.get();
+    std::move(old, stack_top, grown.get());
+
+    for (size_t i = 0; i < frame_count; i++)
+        frames[i].slots = grown.get() + (frames[i].slots - old);
+
+    for (NblUpvalue* upvalue = open_upvalues; upvalue != nullptr; upvalue = upvalue->next)
+        upvalue->location = grown.get() + (upvalue->location - old);
+
+    stack_top = grown.get() + (stack_top - old);
+    stack = std::move(grown);
+    stack_size = grown_size;
+}
+
+void VM::tail_call(Value method, int argc, const uint8_t* ip)
+{
+    // method is what LOAD_METHOD found, nil when the callee sits below the arguments
+    Value& callee = stack_top[-1 - argc];
+
+    if (method.is_nil())
+    {
+        if (callee.is_closure())
+        {
+            method = callee;
+        }
+        else if (callee.is_bound_method())
+        {
+            NblBoundMethod* bound = callee.as_object<NblBoundMethod>();
+            Value receiver = bound->receiver;
+            method = bound->method;
+            callee = std::move(receiver);
+        }
+        else
+        {
+            // classes and natives are called as usual, the RETURN after the call hands back the result
+            call_value(argc, ip);
+            return;
+        }
+    }
+
+    NblClosure* closure = method.as_object<NblClosure>();
+    NblPrototype* prototype = closure->prototype.get();
+    CallFrame* frame = &frames[frame_count - 1];
+
+    if (argc != prototype->arity)
+        runtime_error(ip, "Expected " + std::to_string(prototype->arity) + " arguments but got " + std::to_string(argc));
+
+    size_t base = frame->slots - stack.get();
+
+    if (base + prototype->max_stack > stack_size)
+        grow_stack(base + prototype->max_stack);
+
+    // the callee and its arguments replace the caller's slots, the frame is reused
+    close_upvalues(frame->slots);
+    std::move(stack_top - argc - 1, stack_top, frame->slots);
+
+    while (stack_top > frame->slots + argc + 1)
+        discard();
+
+    *frame = CallFrame{closure, prototype->chunk.code.data(), frame->slots};
+    budget.tick();
+}
+
+void VM::import_file(const std::string& path, const uint8_t* ip)
+{
+    // errors in the imported file end the program, same as the tree-walker
+    std::unique_ptr<Ast> module = parse(load_file(path), path);
+
+    if (Error::has_error)
+        exit(2);
+
+    Compiler compiler{*this};
+    Ref<NblPrototype> script = compiler.compile(module->statements);
+    module.reset();
+
+    if (Error::has_error)
+        exit(2);
+
+    NblClosure* closure = new NblClosure(script);
+    push(closure);
+    call_closure(closure, 0, ip);
+}
+
+NblUpvalue* VM::capture_upvalue(Value* local)
+{
+    // closures capturing the same variable share one upvalue
+    NblUpvalue* previous = nullptr;
+    NblUpvalue* upvalue = open_upvalues;
+
+    while (upvalue != nullptr && upvalue->location > local)
+    {
+        previous = upvalue;
+        upvalue = upvalue->next;
+    }
+
+    if (upvalue != nullptr && upvalue->location == local)
+        return upvalue;
+
+    NblUpvalue* created = new NblUpvalue(local);
+    created->retain(); // the open list holds a reference until the upvalue is closed
+    created->next = upvalue;
+
+    if (previous == nullptr)
+        open_upvalues = created;
+    else
+        previous->next = created;
+
+    return created;
+}
+
+void VM::close_upvalues(Value* last)
+{
+    // move every variable at or above last off the stack
+    while (open_upvalues != nullptr && open_upvalues->location >= last)
+    {
+        NblUpvalue* upvalue = open_upvalues;
+        upvalue->closed = std::move(*upvalue->location);
+        upvalue->location = &upvalue->closed;
+        open_upvalues = upvalue->next;
+        upvalue->release();
+    }
+}
+
+void VM::reset()
+{
+    // drop whatever the failed program left behind
+    close_upvalues(stack.get());
+
+    while (stack_top > stack.get())
+        discard();
+
+    frame_count = 0;
+}
+
+Token VM::call_site(const uint8_t* ip)
+{
+    // the bytecode keeps lines, not tokens
+    const Chunk& chunk = frames[frame_count - 1].closure->prototype->chunk;
+    return Token(TOKEN_EOF, chunk.lines[ip - chunk.code.data() - 1]);
+}
+
+void VM::runtime_error(const uint8_t* ip, const std::string& msg)
+{
+    throw RuntimeError(call_site(ip), msg);
+}
+
+void VM::define_native(const std::string& name, NblNative* native)
+{
+    Global& global = globals[global_slot(name)];
+    global.value = native;
+    global.defined = true;
+}
@@ -0,0 +1,78 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+// a host embedding the engines, its callback interrupts a running script every few steps
+// the script goes on where it stopped, or is cancelled and the engine runs the next one
+
+#include "util.hpp"
+#include "vm.hpp"
+#include "closure_engine.hpp"
+
+static std::unique_ptr<Engine> make_engine(const std::string& name, Heap& heap)
+{
+    if (name == "vm")
+        return std::make_unique<VM>(heap);
+
+    if (name == "closure")
+        return std::make_unique<ClosureEngine>(heap);
+
+    return std::make_unique<Interpreter>(heap);
+}
+
+static void run_text(Engine& engine, const std::string& text)
+{
+    Error::has_runtime_error = false;
+    run(Source::add(text), engine, "");
+}
+
+static void test_engine(const std::string& name)
+{
+    std::cout << "engine " << name << "\n";
+
+    Heap heap;
+    std::unique_ptr<Engine> engine = make_engine(name, heap);
+
+    // every other step the host takes over, and runs a script of its own in another engine
+    Heap other_heap;
+    std::unique_ptr<Engine> other = make_engine(name, other_heap);
+    run_text(*other, "mut calls = 0;");
+
+    engine->budget.set_callback(2, [&](uint64_t steps)
+    {
+        std::cout << "host at " << steps << " steps\n";
+        run_text(*other, "calls = calls + 1;");
+        return true;
+    });
+
+    run_text(*engine, "mut total = 0; for (mut i = 1; i <= 5; i = i + 1) { total = total + i; print(total); }");
+    run_text(*other, "print(calls);");
+
+    // cancelled at the next callback, the globals stay as the script left them
+    engine->budget.set_callback(10, [](uint64_t) { return false; });
+    run_text(*engine, "while (true) { total = total + 1; }");
+
+    // an engine built, run and freed inside the callback gives the running script its heap back
+    engine->budget.set_callback(3, [&](uint64_t steps)
+    {
+        Heap scratch;
+        std::unique_ptr<Engine> inner = make_engine(name, scratch);
+        run_text(*inner, "class Box { init(inner) { this.inner = inner; } } print(Box(Box([1])).inner.inner);");
+        return true;
+    });
+
+    run_text(*engine, "mut boxes = nil; for (mut i = 0; i < 6; i = i + 1) { boxes = [boxes, i]; } print(boxes);");
+
+    engine->budget.set_callback(0, nullptr);
+    run_text(*engine, "print(total); mut rest = [1, 2, 3]; print(len(rest));");
+    std::cout << "taken " << engine->budget.taken() << ", other " << other->budget.taken() << "\n";
+}
+
+int main()
+{
+    for (const char* name : {"tree", "vm", "closure"})
+        test_engine(name);
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+//------------------------------------//
+// Copyright 2024 Nam Nguyen
+// Licensed under Apache License v2.0
+//------------------------------------//
+
+// a host that keeps an engine after its script ran out of memory
+// what the script built before the error is still whole, the next script can use it
+
+#include <sstream>
+
+#include "util.hpp"
+#include "vm.hpp"
+#include "closure_engine.hpp"
+
+static const int FIELDS = 3000;
+
+static std::unique_ptr<Engine> make_engine(const std::string& name, Heap& heap)
+{
+    if (name == "vm")
+        return std::make_unique<VM>(heap);
+
+    if (name == "closure")
+        return std::make_unique<ClosureEngine>(heap);
+
+    return std::make_unique<Interpreter>(heap);
+}
+
+// runs text in the engine, returns what it printed
+static std::string run_text(Engine& engine, const std::string& text)
+{
+    std::ostringstream output;
+    std::streambuf* saved = std::cout.rdbuf(output.rdbuf());
+    Error::has_runtime_error = false;
+    run(Source::add(text), engine, "");
+    std::cout.rdbuf(saved);
+    return output.str();
+}
+
+static void test_engine(const std::string& name)
+{
+    std::cout << "engine " << name << "\n";
+
+    Heap heap;
+    std::unique_ptr<Engine> engine = make_engine(name, heap);
+    run_text(*engine, "class Bag {} mut bag = Bag(); fun step() {}");
+
+    std::string fill;
+    std::string sum = "mut sum = 0;";
+
+    for (int i = 0; i < FIELDS; i++)
+    {
+        fill += "bag.f" + std::to_string(i) + " = 1; step();";
+        sum += "sum = sum + bag.f" + std::to_string(i) + ";";
+    }
+
+    // half way through, the heap is capped with room for the shapes of the next fields
+    // but not for the field storage to double once more, so a field fails to go in
+    engine->budget.set_callback(1, [&](uint64_t steps)
+    {
+        if (steps == FIELDS / 2)
+            heap.set_limit(heap.stats.bytes + 110 * 1024);
+
+        return true;
+    });
+
+    std::string error = run_text(*engine, fill);
+    std::cout << error.substr(0, error.find(',')) << "\n";
+
+    // the fields that went in are all there, and the rest can still be added
+    engine->budget.set_callback(0, nullptr);
+    heap.set_limit(0);
+    run_text(*engine, fill);
+    std::cout << run_text(*engine, sum + "print(sum);");
+}
+
+int main()
+{
+    for (const char* name : {"tree", "vm", "closure"})
+        test_engine(name);
+
+    return 0;
+}
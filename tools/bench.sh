@@ -9,6 +9,7 @@ GREEN='\033[0;32m'
 NC='\033[0m'
 
 declare -A elapsed_times # associative array (basically a dictionary)
+flags="$@" # passed on to nimble, e.g. --engine=vm
 
 NBL_FILES=$(find benchmark -name '*.nbl')
 
@@ -16,7 +17,7 @@ for program in $NBL_FILES; do
     echo "Running benchmark: $program"
 
     # run and capture output
-    output=$(./bin/nimble "$program")
+    output=$(./bin/nimble $flags "$program")
     
     # extract elapsed time
     elapsed_time=$(echo "$output" | grep 'Elapsed:' | awk '{print $2}')
@@ -0,0 +1,47 @@
+#!/usr/bin/env bash
+
+#------------------------------------#
+# Copyright 2024 Nam Nguyen
+# Licensed under Apache License v2.0
+#------------------------------------#
+
+GREEN='\033[0;32m'
+NC='\033[0m'
+
+flags="$@" # passed on to nimble, e.g. --engine=vm
+corpus=$(mktemp --suffix=.nbl)
+trap 'rm -f "$corpus"' EXIT
+
+# a generated corpus of declarations only, so running it costs next to nothing
+# comments, indentation, strings, numbers, keywords and identifiers in the mix of ordinary code
+awk -v copies="${LEXBENCH_COPIES:-20000}" 'BEGIN {
+    for (i = 0; i < copies; i++) {
+        printf "// shape number %d, the fields are set in init and read by the methods below\n", i
+        printf "class Shape%d\n{\n", i
+        printf "    init(width, height)\n    {\n"
+        printf "        this.width = width * %d.25;\n", i
+        printf "        this.height = height + %d;\n", i % 97
+        printf "        this.label = \"shape %d, a label long enough to take a few blocks\";\n    }\n\n", i
+        printf "    area()\n    {\n"
+        printf "        if (this.width > 0 and this.height > 0) { return this.width * this.height; }\n"
+        printf "        return nil; // empty shapes have no area\n    }\n}\n\n"
+        printf "fun scale_%d(shape, factor)\n{\n", i
+        printf "    mut result = [];\n"
+        printf "    for (mut k = 0; k < factor; k += 1) { result = result + [shape.area() * 1.5]; }\n"
+        printf "    while (factor > 1000000) { factor = factor / 2; }\n"
+        printf "    return result;\n}\n\n"
+    }
+}' > "$corpus"
+
+echo "Lexing $(du -h "$corpus" | cut -f1) of generated code"
+
+# the lexer time comes from --phase-times, printed to stderr when the program ends
+lex_ms=$(./bin/nimble $flags --phase-times "$corpus" 2>&1 >/dev/null | grep 'lex:' | awk '{print $2}')
+bytes=$(wc -c < "$corpus")
+
+if [ -z "$lex_ms" ]; then
+    echo "nimble failed to run the corpus"
+    exit 1
+fi
+
+echo -e "Lexer: ${lex_ms} ms, ${GREEN}$(awk -v b="$bytes" -v ms="$lex_ms" 'BEGIN { printf "%.1f", b / 1048576 / (ms / 1000) }') MB/s${NC}"
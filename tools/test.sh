@@ -10,6 +10,7 @@ GREEN='\033[0;32m'
 NC='\033[0m'
 
 failed=0; # number of failed cases
+flags="$@"; # passed on to nimble, e.g. --engine=vm
 
 NBL_FILES=$(find tests -name '*.nbl');
 
@@ -19,12 +20,24 @@ for nbl in $NBL_FILES; do
 
     # run and get difference between output and expected output
     echo "Running test case $nbl...";
-    if ! ./bin/nimble $nbl | diff -u --color "$expected" -; then
+    if ! ./bin/nimble $flags $nbl | diff -u --color "$expected" -; then
         echo "Test case $nbl failed!";
         failed=$((failed + 1)); # count failed cases
     fi;
 done;
 
+# programs embedding the engines, built by make test
+for host in tests/host/*.cpp; do
+    expected=${host%.cpp}.expected;
+    binary=bin/test-$(basename "$host" .cpp);
+
+    echo "Running host test $host...";
+    if ! ./$binary | diff -u --color "$expected" -; then
+        echo "Host test $host failed!";
+        failed=$((failed + 1));
+    fi;
+done;
+
 if [ $failed -eq 0 ]; then
     echo;
     echo -e "${GREEN}All test cases passed${NC}";
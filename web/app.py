@@ -17,7 +17,7 @@ def run_code():
     try:
         cwd = os.getcwd()
         binary_path = cwd + '/bin/nimble'
-        result = subprocess.run([binary_path, 'program.nbl'], capture_output=True, text=True, timeout=5)
+        result = subprocess.run([binary_path, '--max-heap=256M', '--max-steps=50M', '--max-call-depth=10000', 'program.nbl'], capture_output=True, text=True, timeout=5)
         output = result.stdout
         error = result.stderr
     except subprocess.TimeoutExpired: